@@ -4,5 +4,6 @@ SUBDIRS += \
     KarbowyLib \
     gtest \
     KarbowyTests \
+    KarbowyBenchmarks \
     StacjaSzefa \
     StacjaPracownika
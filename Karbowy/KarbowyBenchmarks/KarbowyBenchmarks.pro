@@ -0,0 +1,32 @@
+TEMPLATE = app
+CONFIG += console c++14
+CONFIG -= app_bundle
+CONFIG -= qt
+
+SOURCES += \
+    main.cpp \
+    logsqueries.cpp \
+    logparsing.cpp \
+    timestamps.cpp \
+    handshake.cpp \
+    ingestion.cpp \
+    ../StacjaSzefa/predefinedqueries.cpp \
+    ../StacjaSzefa/sessionhelpers.cpp \
+    ../StacjaSzefa/logingestor.cpp \
+    ../StacjaSzefa/logprocessor.cpp \
+    ../StacjaSzefa/tasklistcache.cpp
+
+HEADERS += \
+    benchmarks.h
+
+LIBS += -L$$OUT_PWD/../KarbowyLib/ -lKarbowyLib
+
+INCLUDEPATH += $$PWD/../KarbowyLib $$PWD/../StacjaSzefa
+DEPENDPATH += $$PWD/../KarbowyLib
+
+unix: CONFIG += link_pkgconfig
+unix: PKGCONFIG += sqlite3 libcrypto++
+
+LIBS += -lpthread
+
+QMAKE_CXXFLAGS_RELEASE += -O2
@@ -0,0 +1,26 @@
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <chrono>
+#include <string>
+
+// average duration of single call of fn, in microseconds
+template <typename Functor>
+double measure(size_t iterations, Functor&& fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        fn();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    return std::chrono::duration<double, std::micro>(elapsed).count() / iterations;
+}
+
+void logsQueriesBenchmark(size_t maxNumOfRows);
+void logParsingBenchmark(size_t numOfLines);
+void timestampsBenchmark(size_t numOfTimestamps);
+void handshakeBenchmark(size_t numOfLogins);
+void ingestionBenchmark(size_t numOfEntries);
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,163 @@
+#include "benchmarks.h"
+#include "crypto.h"
+#include "protocol.h"
+#include "eventdispatcher.h"
+#include "task.h"
+#include <crypto++/filters.h>
+#include <crypto++/hex.h>
+#include <crypto++/osrng.h>
+#include <crypto++/sha.h>
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// previous implementation: generator seeded from operating system and filter pipelines for every value
+
+static std::string generateChallengeWithNewPool()
+{
+    CryptoPP::AutoSeededRandomPool prng;
+    CryptoPP::SecByteBlock seed(16);
+    prng.GenerateBlock(seed, seed.size());
+    std::string challenge;
+    CryptoPP::ArraySource(seed, seed.size(), true, new CryptoPP::HexEncoder(new CryptoPP::StringSink(challenge)));
+    return challenge;
+}
+
+static std::string shaWithPipeline(const std::string& message)
+{
+    CryptoPP::SHA256 hash;
+    std::string digest;
+    CryptoPP::StringSource s(message, true, new CryptoPP::HashFilter(hash, new CryptoPP::HexEncoder(new CryptoPP::StringSink(digest))));
+    return digest;
+}
+
+static const char* SERVER_UUID = "7d444840-9dc0-11d1-b245-5ffdce74fad2";
+static const char* CLIENT_UUID = "6ba7b810-9dad-11d1-80b4-00c04fd430c8";
+static const char* PASSWORD = "pass4";
+static const uint16_t PORT = 21470;
+// every login keeps its connection open until the end, each of them takes two descriptors
+static const size_t MAX_LOOPBACK_LOGINS = 1000;
+
+// crypto done by both ends of single login: three challenges, three responses and their verification
+template <typename GenerateChallenge, typename Sha>
+static size_t loginCrypto(GenerateChallenge&& generateChallenge, Sha&& sha)
+{
+    size_t checksum = 0;
+    static const std::string secrets[] = { SERVER_UUID, SERVER_UUID, PASSWORD };
+    for (const auto& secret : secrets)
+    {
+        std::string challenge = generateChallenge();
+        std::string response = sha(secret, challenge);
+        checksum += (sha(secret, challenge) == response) + challenge.size();
+    }
+    return checksum;
+}
+
+template <typename GenerateChallenge, typename Sha>
+static void measureLoginCrypto(const char* name, size_t numOfLogins, GenerateChallenge generateChallenge, Sha sha)
+{
+    size_t checksum = 0;
+    double micros = measure(numOfLogins, [&]() { checksum += loginCrypto(generateChallenge, sha); });
+
+    // the same on every core at once, generators of all threads compete for operating system's entropy
+    unsigned numOfThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<double> threadMicros(numOfThreads);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < numOfThreads; ++i)
+    {
+        threads.emplace_back([&, i]()
+        {
+            size_t threadChecksum = 0;
+            threadMicros[i] = measure(numOfLogins, [&]() { threadChecksum += loginCrypto(generateChallenge, sha); });
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    double averageMicros = 0;
+    for (double m : threadMicros)
+    {
+        averageMicros += m / numOfThreads;
+    }
+
+    std::cout << name << " (checksum " << checksum << "): " << micros << " us/login, "
+              << static_cast<size_t>(1e6 / micros) << " logins/s per core; on "
+              << numOfThreads << " cores " << static_cast<size_t>(1e6 / averageMicros) << " logins/s per core" << std::endl;
+}
+
+// complete handshakes over loopback, client and server share one thread
+static void measureLoopbackLogins(size_t numOfLogins)
+{
+    MainLoop loop;
+    Ipv4Listener listener(PORT, Listener::DEFAULT_BACKLOG, true);
+    std::string serverUuid(SERVER_UUID);
+    std::string error;
+    auto onError = [&](const std::string& msg)
+    {
+        error = msg;
+        loop.exit();
+    };
+
+    ServerCallbacks callbacks;
+    callbacks._findPassword = [](const std::string&) { return boost::make_optional(std::string(PASSWORD)); };
+    callbacks._onLogin = [](const std::string&, const std::string&, const ServerCallbacks::LoginDoneCallback& onDone)
+    {
+        onDone(std::string());
+    };
+    // client has no way to close its connection, all of them stay open until the end
+    std::vector<std::unique_ptr<AsyncServerConnection> > servers;
+    AsyncListener asyncListener(listener, [&](Descriptor&& fd)
+    {
+        servers.push_back(std::make_unique<AsyncServerConnection>(loop, std::move(fd), serverUuid, false, callbacks,
+                                                                  [](const std::string&) { }));
+        servers.back()->start();
+    }, onError);
+    loop.addObject(asyncListener);
+
+    ClientConfig config { CLIENT_UUID, SERVER_UUID, "127.0.0.1", PORT, "wwisniew", PASSWORD, false, false };
+    std::vector<std::unique_ptr<AsyncClient> > clients;
+    std::function<void()> login = [&]()
+    {
+        clients.push_back(std::make_unique<AsyncClient>(loop, config, onError, []() { }));
+        clients.back()->connect([&]()
+        {
+            if (clients.size() == numOfLogins)
+            {
+                loop.exit();
+                return;
+            }
+            login();
+        });
+    };
+
+    // client traces every step to std::cout, that would be measured instead of handshake
+    std::streambuf* coutBuffer = std::cout.rdbuf(nullptr);
+    loop.start();
+    double micros = measure(1, [&]()
+    {
+        login();
+        loop.run();
+    }) / numOfLogins;
+    std::cout.rdbuf(coutBuffer);
+    std::cout.clear();
+    loop.removeAllObjects();
+
+    if (! error.empty())
+    {
+        throw std::runtime_error(error);
+    }
+    std::cout << "loopback handshakes: " << micros << " us/login, "
+              << static_cast<size_t>(1e6 / micros) << " logins/s on one core (client and server together)" << std::endl;
+}
+
+void handshakeBenchmark(size_t numOfLogins)
+{
+    std::cout << numOfLogins << " logins" << std::endl;
+    measureLoginCrypto("crypto, new pool and pipelines", numOfLogins, generateChallengeWithNewPool,
+                       [](const std::string& secret, const std::string& challenge) { return shaWithPipeline(secret + challenge); });
+    measureLoginCrypto("crypto, per-thread pool and hash", numOfLogins, generateChallenge, sha256Hex);
+    measureLoopbackLogins(std::min(numOfLogins, MAX_LOOPBACK_LOGINS));
+}
@@ -0,0 +1,110 @@
+#include "benchmarks.h"
+#include "predefinedqueries.h"
+#include "sessionhelpers.h"
+#include "logingestor.h"
+#include "logentry.h"
+#include "concat.h"
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <unistd.h>
+
+static const char* dbFileName = "KarbowyIngestion.db";
+static const char* CLIENT_UUID = "6ba7b810-9dad-11d1-80b4-00c04fd430c8";
+static const char* employees[] = { "ybarodzi", "mlukashe", "tlukashe", "wwisniew" };
+static const int NUM_OF_EMPLOYEES = sizeof(employees) / sizeof(employees[0]);
+// every entry of per-row path waits for its own commit, more of them would take minutes
+static const size_t MAX_PER_ROW_ENTRIES = 5000;
+
+static void removeDatabase()
+{
+    unlink(dbFileName);
+    unlink((std::string(dbFileName) + "-wal").c_str());
+    unlink((std::string(dbFileName) + "-shm").c_str());
+    unlink((std::string(dbFileName) + "-journal").c_str());
+}
+
+// one day's backlog of a station, in order of upload
+static std::vector<LogEntry> makeUpload(size_t numOfEntries)
+{
+    Timestamp start = Clock::now() - std::chrono::hours(24);
+    std::vector<LogEntry> entries;
+    entries.reserve(numOfEntries);
+    for (size_t i = 0; i < numOfEntries; ++i)
+    {
+        entries.push_back(LogEntry { i % 2 == 0 ? LogEntryType_TASK_START : LogEntryType_TASK_PAUSE,
+                                     start + std::chrono::seconds(i),
+                                     employees[i % NUM_OF_EMPLOYEES],
+                                     1 });
+    }
+    return entries;
+}
+
+static void printRate(const char* name, size_t numOfEntries, double micros)
+{
+    std::cout << "  " << std::setw(36) << std::left << name << std::right
+              << std::setw(12) << static_cast<size_t>(numOfEntries * 1e6 / micros) << " entries/s" << std::endl;
+}
+
+// LOG UPLOAD before batching: every line inserted in autocommit mode as soon as it's parsed
+static void measurePerRow(const std::vector<LogEntry>& upload, int clientId)
+{
+    size_t numOfEntries = std::min(upload.size(), MAX_PER_ROW_ENTRIES);
+    auto& insert = insertLogEntryC();
+    double micros = measure(1, [&]()
+    {
+        for (size_t i = 0; i < numOfEntries; ++i)
+        {
+            const LogEntry& entry = upload[i];
+            insert.execute(entry._type, clientId, entry._userId, entry._timestamp, entry._taskId);
+        }
+    });
+    printRate("per row, autocommit", numOfEntries, micros);
+}
+
+static void measureBatched(const std::vector<LogEntry>& upload, int clientId, size_t batchSize)
+{
+    IngestionConfig config;
+    config._batchSize = batchSize;
+    double micros = measure(1, [&]()
+    {
+        LogIngestor ingestor(clientId, config);
+        for (const LogEntry& entry : upload)
+        {
+            ingestor.add(LogEntry(entry));
+        }
+        ingestor.finish();
+    });
+    std::string name = batchSize > 0 ? concat("LogIngestor, batches of ", batchSize) : "LogIngestor, whole upload at once";
+    printRate(name.c_str(), upload.size(), micros);
+}
+
+void ingestionBenchmark(size_t numOfEntries)
+{
+    std::vector<LogEntry> upload = makeUpload(numOfEntries);
+    // settings of StacjaSzefa.db before DatabaseConfig, and the current defaults
+    DatabaseConfig rollbackJournal;
+    rollbackJournal._journalMode = "DELETE";
+    rollbackJournal._synchronous = "FULL";
+    const std::pair<const char*, DatabaseConfig> configs[] = {
+        { "journal_mode=DELETE, synchronous=FULL", rollbackJournal },
+        { "journal_mode=WAL, synchronous=NORMAL", DatabaseConfig() }
+    };
+
+    std::cout << numOfEntries << " entries in upload" << std::endl;
+    for (const auto& config : configs)
+    {
+        std::cout << config.first << std::endl;
+        removeDatabase();
+        initializeDatabase(dbFileName, config.second);
+        int clientId = registerClient(CLIENT_UUID);
+        measurePerRow(upload, clientId);
+        for (size_t batchSize : { 100, 1000, 0 })
+        {
+            measureBatched(upload, clientId, batchSize);
+        }
+        shutdownDatabase();
+    }
+    removeDatabase();
+}
@@ -0,0 +1,72 @@
+#include "benchmarks.h"
+#include "protocol.h"
+#include "parse.h"
+#include "concat.h"
+#include <iostream>
+#include <vector>
+
+static const char* verbs[] = { "LOGIN", "TASK 17 START", "TASK 17 PAUSE", "TASK 4242 FINISH", "LOGOUT" };
+static const size_t NUM_OF_VERBS = sizeof(verbs) / sizeof(verbs[0]);
+
+// previous implementation: whole line parsed again for every alternative
+static bool parseLogEntryByTrial(const std::string& line, LogEntry& entry)
+{
+    int taskId;
+    if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId), " LOGIN"))
+    {
+        entry._type = LogEntryType_LOGIN;
+    }
+    else if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId), " LOGOUT"))
+    {
+        entry._type = LogEntryType_LOGOUT;
+    }
+    else if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId), " TASK ", IntToken(taskId), " START"))
+    {
+        entry._type = LogEntryType_TASK_START;
+    }
+    else if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId), " TASK ", IntToken(taskId), " PAUSE"))
+    {
+        entry._type = LogEntryType_TASK_PAUSE;
+    }
+    else if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId), " TASK ", IntToken(taskId), " FINISH"))
+    {
+        entry._type = LogEntryType_TASK_FINISH;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+template <typename Parser>
+static void measureParser(const char* name, const std::vector<std::string>& lines, Parser&& parser)
+{
+    size_t next = 0;
+    size_t failures = 0;
+    LogEntry entry;
+    double micros = measure(lines.size(), [&]()
+    {
+        if (! parser(lines[next++], entry))
+        {
+            ++failures;
+        }
+    });
+    std::cout << name << ": " << micros * 1000 << " ns/line, "
+              << static_cast<size_t>(1e6 / micros) << " lines/s"
+              << (failures > 0 ? concat(", ", failures, " FAILURES") : std::string()) << std::endl;
+}
+
+void logParsingBenchmark(size_t numOfLines)
+{
+    std::vector<std::string> lines;
+    lines.reserve(numOfLines);
+    Timestamp start = Clock::now() - std::chrono::hours(24 * 7);
+    for (size_t i = 0; i < numOfLines; ++i)
+    {
+        lines.push_back(concat(formatTimestamp(start + std::chrono::milliseconds(i * 1337)), " wwisniew ", verbs[i % NUM_OF_VERBS]));
+    }
+    std::cout << numOfLines << " lines" << std::endl;
+    measureParser("trial parsing", lines, parseLogEntryByTrial);
+    measureParser("single pass", lines, parseLogEntry);
+}
@@ -0,0 +1,94 @@
+#include "benchmarks.h"
+#include "predefinedqueries.h"
+#include "serverlogentry.h"
+#include <iostream>
+#include <iomanip>
+#include <unistd.h>
+
+static const char* dbFileName = "KarbowyBenchmarks.db";
+static const int NUM_OF_CLIENTS = 100;
+static const char* employees[] = { "ybarodzi", "mlukashe", "tlukashe", "wwisniew" };
+static const int NUM_OF_EMPLOYEES = sizeof(employees) / sizeof(employees[0]);
+// unprocessed entries of measured employee, rest of history is processed
+static const int NUM_OF_UNPROCESSED = 20;
+
+static void removeDatabase()
+{
+    unlink(dbFileName);
+    unlink((std::string(dbFileName) + "-wal").c_str());
+    unlink((std::string(dbFileName) + "-shm").c_str());
+}
+
+// appends processed history entries, timestamps grow with row number
+static void appendHistory(size_t from, size_t to, const Timestamp& start)
+{
+    Database& db = database();
+    auto& insert = db.statement<Command<int, int, std::string, Timestamp, boost::optional<int> > >(
+                "INSERT INTO Logs(type, client, employee, timestamp, task, processed)\n"
+                "VALUES (?, ?, ?, ?, ?, 1)\n");
+    Transaction transaction(db, TransactionType_IMMEDIATE);
+    for (size_t row = from; row < to; ++row)
+    {
+        insert.execute(row % 2 == 0 ? LogEntryType_TASK_START : LogEntryType_TASK_PAUSE,
+                       row % NUM_OF_CLIENTS + 1,
+                       employees[row % NUM_OF_EMPLOYEES],
+                       start + std::chrono::seconds(row),
+                       1);
+    }
+    transaction.commit();
+}
+
+static void moveUnprocessedToEnd(size_t numOfRows, const Timestamp& start)
+{
+    Database& db = database();
+    db.execute("DELETE FROM Logs WHERE processed = 0");
+    auto& insert = insertLogEntryC();
+    Transaction transaction(db, TransactionType_IMMEDIATE);
+    for (int i = 0; i < NUM_OF_UNPROCESSED; ++i)
+    {
+        insert.execute(LogEntryType_TASK_START, 1, "wwisniew", start + std::chrono::seconds(numOfRows + i), 1);
+    }
+    transaction.commit();
+}
+
+void logsQueriesBenchmark(size_t maxNumOfRows)
+{
+    static const size_t ITERATIONS = 1000;
+
+    removeDatabase();
+    initializeDatabase(dbFileName, DatabaseConfig());
+    Timestamp start = Clock::now() - std::chrono::hours(24 * 365);
+
+    std::cout << std::setw(12) << "rows"
+              << std::setw(28) << "unprocessed for employee"
+              << std::setw(28) << "last entry of client" << std::endl;
+    size_t numOfRows = 0;
+    for (size_t target = 10000; numOfRows < maxNumOfRows; target *= 10)
+    {
+        target = std::min(target, maxNumOfRows);
+        appendHistory(numOfRows, target, start);
+        numOfRows = target;
+        moveUnprocessedToEnd(numOfRows, start);
+
+        auto& unprocessed = findUnprocessedLogEntriesForEmployeeQ();
+        double unprocessedTime = measure(ITERATIONS, [&]()
+        {
+            unprocessed.execute("wwisniew");
+            ServerLogEntry entry;
+            while (unprocessed.next(entry)) { }
+        });
+        auto& lastEntry = findLastLogEntryTimeForClientQ();
+        double lastEntryTime = measure(ITERATIONS, [&]()
+        {
+            lastEntry.execute(NUM_OF_CLIENTS / 2);
+            boost::optional<Timestamp> timestamp;
+            while (lastEntry.next(timestamp)) { }
+        });
+        std::cout << std::setw(12) << numOfRows
+                  << std::setw(25) << std::fixed << std::setprecision(1) << unprocessedTime << " us"
+                  << std::setw(25) << lastEntryTime << " us" << std::endl;
+    }
+
+    shutdownDatabase();
+    removeDatabase();
+}
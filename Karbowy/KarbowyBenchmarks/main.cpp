@@ -0,0 +1,61 @@
+#include "benchmarks.h"
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+
+static void usage(const char* programName)
+{
+    std::cerr << "usage: " << programName << " logs [max rows]" << std::endl
+              << "       " << programName << " parse [lines]" << std::endl
+              << "       " << programName << " timestamps [count]" << std::endl
+              << "       " << programName << " handshake [logins]" << std::endl
+              << "       " << programName << " ingestion [entries]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    try
+    {
+        if (strcmp(argv[1], "logs") == 0)
+        {
+            size_t maxNumOfRows = argc > 2 ? strtoul(argv[2], nullptr, 10) : 2000000;
+            logsQueriesBenchmark(maxNumOfRows);
+        }
+        else if (strcmp(argv[1], "parse") == 0)
+        {
+            size_t numOfLines = argc > 2 ? strtoul(argv[2], nullptr, 10) : 3000000;
+            logParsingBenchmark(numOfLines);
+        }
+        else if (strcmp(argv[1], "timestamps") == 0)
+        {
+            size_t numOfTimestamps = argc > 2 ? strtoul(argv[2], nullptr, 10) : 1000000;
+            timestampsBenchmark(numOfTimestamps);
+        }
+        else if (strcmp(argv[1], "handshake") == 0)
+        {
+            size_t numOfLogins = argc > 2 ? strtoul(argv[2], nullptr, 10) : 10000;
+            handshakeBenchmark(numOfLogins);
+        }
+        else if (strcmp(argv[1], "ingestion") == 0)
+        {
+            size_t numOfEntries = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000;
+            ingestionBenchmark(numOfEntries);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    catch (std::exception& ex)
+    {
+        std::cerr << "Exception: " << ex.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
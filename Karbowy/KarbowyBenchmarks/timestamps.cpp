@@ -0,0 +1,99 @@
+#include "benchmarks.h"
+#include "timestamp.h"
+#include "parse.h"
+#include <boost/format.hpp>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <string.h>
+#include <time.h>
+
+// previous implementations, based on gmtime_r / boost::format and mktime
+
+static std::string formatTimestampWithGmtime(const Timestamp& timestamp)
+{
+    time_t time = Clock::to_time_t(timestamp);
+    tm t;
+    if (gmtime_r(&time, &t) == nullptr)
+    {
+        throw std::runtime_error("gmtime_r error");
+    }
+    int milis = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp - Clock::from_time_t(time)).count();
+    std::ostringstream stream;
+    stream << boost::format("%04d-%02d-%02d %02d:%02d:%02d.%03d") % (t.tm_year + 1900) % (t.tm_mon + 1) % t.tm_mday
+                                                                  % t.tm_hour  % t.tm_min % t.tm_sec %  milis;
+    return stream.str();
+}
+
+static bool parseTimestampWithMktime(const std::string& str, Timestamp& timestamp)
+{
+    tm t;
+    memset(&t, 0, sizeof(t));
+    int millis;
+    if (! parse(str,
+                IntToken(t.tm_year, 4), '-', IntToken(t.tm_mon, 2), '-', IntToken(t.tm_mday, 2), ' ',
+                IntToken(t.tm_hour, 2), ':', IntToken(t.tm_min, 2), ':', IntToken(t.tm_sec, 2), '.', IntToken(millis, 3)))
+    {
+        return false;
+    }
+    t.tm_year -= 1900;
+    t.tm_mon -= 1;
+    time_t time = mktime(&t);
+    if (time == -1)
+    {
+        return false;
+    }
+    timestamp = Clock::from_time_t(time - timezone) + std::chrono::milliseconds(millis);
+    return true;
+}
+
+static void compare(const char* scenario, const std::vector<Timestamp>& timestamps)
+{
+    std::vector<std::string> texts;
+    texts.reserve(timestamps.size());
+    size_t next = 0;
+    double legacyFormat = measure(timestamps.size(), [&]() { texts.push_back(formatTimestampWithGmtime(timestamps[next++])); });
+    next = 0;
+    char buffer[TIMESTAMP_LENGTH];
+    size_t checksum = 0;
+    double civilFormat = measure(timestamps.size(), [&]()
+    {
+        formatTimestamp(timestamps[next++], buffer);
+        checksum += buffer[TIMESTAMP_LENGTH - 1];
+    });
+
+    Timestamp timestamp;
+    size_t failures = 0;
+    next = 0;
+    double legacyParse = measure(texts.size(), [&]() { failures += ! parseTimestampWithMktime(texts[next++], timestamp); });
+    next = 0;
+    double civilParse = measure(texts.size(), [&]() { failures += ! parseTimestamp(texts[next++].c_str(), timestamp); });
+
+    std::cout << scenario << " (checksum " << checksum << ", " << failures << " failures)" << std::endl
+              << "    format: gmtime_r + boost::format " << legacyFormat * 1000 << " ns, civil " << civilFormat * 1000 << " ns" << std::endl
+              << "    parse:  mktime " << legacyParse * 1000 << " ns, civil " << civilParse * 1000 << " ns" << std::endl;
+}
+
+void timestampsBenchmark(size_t numOfTimestamps)
+{
+    tzset();
+    Timestamp start = Clock::now() - std::chrono::hours(24 * 365 * 5);
+
+    // typical log upload: consecutive entries from the same day
+    std::vector<Timestamp> sameDay;
+    sameDay.reserve(numOfTimestamps);
+    for (size_t i = 0; i < numOfTimestamps; ++i)
+    {
+        sameDay.push_back(start + std::chrono::milliseconds(i % (24 * 3600 * 1000)));
+    }
+    compare("same day", sameDay);
+
+    // worst case for date cache: every timestamp on different day
+    std::vector<Timestamp> differentDays;
+    differentDays.reserve(numOfTimestamps);
+    for (size_t i = 0; i < numOfTimestamps; ++i)
+    {
+        differentDays.push_back(start + std::chrono::hours(25 * (i % 1500)) + std::chrono::milliseconds(i));
+    }
+    compare("different days", differentDays);
+}
@@ -14,8 +14,10 @@ DEFINES += KARBOWYLIB_LIBRARY
 
 SOURCES += \
     database.cpp \
+    databasewriter.cpp \
     sockets.cpp \
     linebuffer.cpp \
+    framing.cpp \
     formatedexception.cpp \
     protocol.cpp \
     eventdispatcher.cpp \
@@ -23,13 +25,16 @@ SOURCES += \
     parse.cpp \
     protocolerror.cpp \
     task.cpp \
-    timestamp.cpp
+    timestamp.cpp \
+    crypto.cpp
 
 HEADERS +=\
         karbowylib_global.h \
     database.h \
+    databasewriter.h \
     sockets.h \
     linebuffer.h \
+    framing.h \
     formatedexception.h \
     protocol.h \
     eventdispatcher.h \
@@ -39,7 +44,8 @@ HEADERS +=\
     parse.h \
     timestamp.h \
     logentry.h \
-    task.h
+    task.h \
+    crypto.h
 
 unix: CONFIG += link_pkgconfig
 unix: PKGCONFIG += sqlite3
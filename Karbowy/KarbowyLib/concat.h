@@ -1,37 +1,119 @@
 #ifndef CONCAT_H
 #define CONCAT_H
 
+#include "timestamp.h"
+#include <string>
 #include <sstream>
+#include <type_traits>
+#include <boost/utility/string_view.hpp>
+
+// Arguments are appended straight to a std::string used as growable output buffer: strings are copied,
+// integers are formatted in place (like to_chars), timestamps with formatTimestamp. Other types fall back
+// to operator<<. concatTo/concatlnTo append to caller's buffer, so it can be reused or handed over
+// to TcpStream / AsyncSocket without another copy.
 
 namespace impl
 {
 
-inline void streamTo(std::ostream&) { }
+inline void appendTo(std::string& out, const std::string& str)
+{
+    out += str;
+}
+
+inline void appendTo(std::string& out, const char* str)
+{
+    out += str;
+}
+
+inline void appendTo(std::string& out, boost::string_view str)
+{
+    out.append(str.data(), str.size());
+}
+
+inline void appendTo(std::string& out, char c)
+{
+    out += c;
+}
+
+inline void appendTo(std::string& out, const Timestamp& timestamp)
+{
+    char buffer[TIMESTAMP_LENGTH];
+    out.append(buffer, formatTimestamp(timestamp, buffer));
+}
+
+template <typename Int>
+typename std::enable_if<std::is_integral<Int>::value, void>::type
+appendTo(std::string& out, Int value)
+{
+    typedef typename std::make_unsigned<Int>::type Unsigned;
+    char buffer[24];
+    char* end = buffer + sizeof(buffer);
+    char* begin = end;
+    bool negative = value < 0;
+    // negation in unsigned type works for minimal value too
+    Unsigned abs = negative ? Unsigned(0) - static_cast<Unsigned>(value) : static_cast<Unsigned>(value);
+    do
+    {
+        *--begin = static_cast<char>('0' + abs % 10);
+        abs /= 10;
+    }
+    while (abs != 0);
+    if (negative)
+    {
+        *--begin = '-';
+    }
+    out.append(begin, end);
+}
+
+template <typename T>
+typename std::enable_if<! std::is_integral<T>::value && ! std::is_convertible<const T&, boost::string_view>::value, void>::type
+appendTo(std::string& out, const T& value)
+{
+    std::ostringstream stream;
+    stream << value;
+    out += stream.str();
+}
+
+inline void concatTo(std::string&) { }
 
 template <typename Arg, typename... RestOfArgs>
-void streamTo(std::ostream& stream, const Arg& arg, const RestOfArgs&... args)
+void concatTo(std::string& out, const Arg& arg, const RestOfArgs&... args)
+{
+    appendTo(out, arg);
+    concatTo(out, args...);
+}
+
+}
+
+template <typename... Args>
+std::string& concatTo(std::string& out, const Args&... args)
 {
-    stream << arg;
-    streamTo(stream, args...);
+    impl::concatTo(out, args...);
+    return out;
 }
 
+template <typename... Args>
+std::string& concatlnTo(std::string& out, const Args&... args)
+{
+    impl::concatTo(out, args...);
+    out += '\n';
+    return out;
 }
 
 template <typename... Args>
 std::string concat(const Args&... args)
 {
-    std::ostringstream stream;
-    impl::streamTo(stream, args...);
-    return stream.str();
+    std::string out;
+    impl::concatTo(out, args...);
+    return out;
 }
 
 template <typename... Args>
 std::string concatln(const Args&... args)
 {
-    std::ostringstream stream;
-    impl::streamTo(stream, args...);
-    stream << std::endl;
-    return stream.str();
+    std::string out;
+    concatlnTo(out, args...);
+    return out;
 }
 
 #endif // CONCAT_H
@@ -0,0 +1,47 @@
+#include "crypto.h"
+#include <crypto++/osrng.h>
+#include <crypto++/sha.h>
+
+static_assert(CryptoPP::SHA256::DIGESTSIZE * 2 == SHA256_HEX_LENGTH, "SHA256_HEX_LENGTH doesn't match digest size");
+
+// AutoSeededRandomPool reads seed from the operating system only in its constructor;
+// generator per thread needs no locking
+static CryptoPP::AutoSeededRandomPool& randomPool()
+{
+    static thread_local CryptoPP::AutoSeededRandomPool pool;
+    return pool;
+}
+
+char* hexEncode(const unsigned char* data, size_t size, char* buffer)
+{
+    // same digits as CryptoPP::HexEncoder used by earlier versions
+    static const char digits[] = "0123456789ABCDEF";
+    for (size_t i = 0; i < size; ++i)
+    {
+        *buffer++ = digits[data[i] >> 4];
+        *buffer++ = digits[data[i] & 0x0f];
+    }
+    return buffer;
+}
+
+std::string generateChallenge()
+{
+    unsigned char random[CHALLENGE_SIZE];
+    randomPool().GenerateBlock(random, sizeof(random));
+    char hex[CHALLENGE_HEX_LENGTH];
+    hexEncode(random, sizeof(random), hex);
+    return std::string(hex, sizeof(hex));
+}
+
+std::string sha256Hex(const std::string& first, const std::string& second)
+{
+    static thread_local CryptoPP::SHA256 hash;
+    unsigned char digest[CryptoPP::SHA256::DIGESTSIZE];
+    hash.Update(reinterpret_cast<const unsigned char*>(first.data()), first.size());
+    hash.Update(reinterpret_cast<const unsigned char*>(second.data()), second.size());
+    // Final restarts hash for next call
+    hash.Final(digest);
+    char hex[SHA256_HEX_LENGTH];
+    hexEncode(digest, sizeof(digest), hex);
+    return std::string(hex, sizeof(hex));
+}
@@ -0,0 +1,22 @@
+#ifndef CRYPTO_H
+#define CRYPTO_H
+
+#include <string>
+#include <cstddef>
+
+// Primitives of the authentication handshake. Random generator and hash context are kept
+// per thread and reused, so a login neither reseeds from the operating system nor builds
+// filter pipelines for every value.
+
+static const size_t CHALLENGE_SIZE = 16;
+static const size_t CHALLENGE_HEX_LENGTH = 2 * CHALLENGE_SIZE;
+static const size_t SHA256_HEX_LENGTH = 64;
+
+// CHALLENGE_SIZE random bytes as uppercase hex digits
+std::string generateChallenge();
+// SHA-256 of first followed by second, as uppercase hex digits
+std::string sha256Hex(const std::string& first, const std::string& second);
+// writes exactly 2 * size uppercase hex digits (without terminating zero), returns pointer past them
+char* hexEncode(const unsigned char* data, size_t size, char* buffer);
+
+#endif // CRYPTO_H
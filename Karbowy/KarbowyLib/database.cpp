@@ -1,4 +1,5 @@
 #include "database.h"
+#include "concat.h"
 
 DatabaseError::DatabaseError(int errorCode, const char* errorMsg) :
     _errorCode(errorCode),
@@ -111,6 +112,13 @@ void ExecuteError::formatWhatMsg(std::ostream &stream) const
            << _errorMsg << " (error code" << _errorCode << ')';
 }
 
+DatabaseConfig::DatabaseConfig() :
+    _journalMode("WAL"),
+    _synchronous("NORMAL"),
+    _cacheSize(-8192),
+    _mmapSize(64 * 1024 * 1024),
+    _busyTimeoutMs(5000) { }
+
 Database::Database(const string &filename)
     : _db(nullptr)
 {
@@ -129,8 +137,15 @@ Database::Database(const string &filename)
     }
 }
 
+Database::Database(const string &filename, const DatabaseConfig& config) :
+    Database(filename)
+{
+    configure(config);
+}
+
 Database::~Database()
 {
+    _statements.clear();
     sqlite3_close(_db);
 }
 
@@ -144,6 +159,36 @@ const char* Database::getErrorMsg(sqlite3* db, int errorCode)
     return db ? sqlite3_errmsg(db) : sqlite3_errstr(errorCode);
 }
 
+void Database::configure(const DatabaseConfig& config)
+{
+    int errorCode = sqlite3_busy_timeout(_db, config._busyTimeoutMs);
+    if (errorCode != SQLITE_OK)
+    {
+        throw ExecuteError(errorCode, getErrorMsg(errorCode), "sqlite3_busy_timeout");
+    }
+    execute(concat("PRAGMA journal_mode = ", config._journalMode));
+    execute(concat("PRAGMA synchronous = ", config._synchronous));
+    execute(concat("PRAGMA cache_size = ", config._cacheSize));
+    execute(concat("PRAGMA mmap_size = ", config._mmapSize));
+}
+
+void Database::execute(const string& queryStr)
+{
+    int errorCode = sqlite3_exec(_db, queryStr.c_str(), nullptr, nullptr, nullptr);
+    if (errorCode != SQLITE_OK)
+    {
+        throw ExecuteError(errorCode, getErrorMsg(errorCode), queryStr);
+    }
+}
+
+void Database::resetStatements()
+{
+    for (auto& statement : _statements)
+    {
+        statement.second->reset();
+    }
+}
+
 sqlite3_stmt* Database::prepareQuery(const string &queryStr)
 {
     const char* cQueryStr = queryStr.c_str();
@@ -178,6 +223,11 @@ QueryBase::~QueryBase()
     sqlite3_finalize(_stmt);
 }
 
+void QueryBase::reset()
+{
+    sqlite3_reset(_stmt);
+}
+
 bool QueryBase::executeStep()
 {
     int result = sqlite3_step(_stmt);
@@ -294,3 +344,95 @@ boost::optional<std::string> retrieveNullableStringColumn(sqlite3_stmt* stmt, in
         throw std::runtime_error("not string nor null");
     }
 }
+
+static Timestamp parseTimestampText(sqlite3_stmt* stmt, int columnIdx)
+{
+    std::string value = retrieveStringColumn(stmt, columnIdx);
+    Timestamp timestamp;
+    if (! parse(value, TimestampToken(timestamp)))
+    {
+        throw std::runtime_error("invalid timestamp");
+    }
+    return timestamp;
+}
+
+Timestamp retrieveTimestampColumn(sqlite3_stmt* stmt, int columnIdx)
+{
+    switch (sqlite3_column_type(stmt, columnIdx))
+    {
+    case SQLITE_INTEGER:
+        return fromEpochMilliseconds(sqlite3_column_int64(stmt, columnIdx));
+    case SQLITE_TEXT:
+        return parseTimestampText(stmt, columnIdx);
+    default:
+        throw std::runtime_error("not timestamp");
+    }
+}
+
+boost::optional<Timestamp> retrieveNullableTimestampColumn(sqlite3_stmt* stmt, int columnIdx)
+{
+    switch (sqlite3_column_type(stmt, columnIdx))
+    {
+    case SQLITE_NULL:
+        return boost::none;
+    case SQLITE_INTEGER:
+        return fromEpochMilliseconds(sqlite3_column_int64(stmt, columnIdx));
+    case SQLITE_TEXT:
+        return parseTimestampText(stmt, columnIdx);
+    default:
+        throw std::runtime_error("not timestamp nor null");
+    }
+}
+
+Transaction::Transaction(Database& db, TransactionType type) :
+    _db(db),
+    _finished(false)
+{
+    _db.execute(type == TransactionType_IMMEDIATE ? "BEGIN IMMEDIATE" : "BEGIN");
+}
+
+Transaction::~Transaction()
+{
+    if (! _finished)
+    {
+        try
+        {
+            _db.execute("ROLLBACK");
+        }
+        catch (std::exception&)
+        {
+            // sqlite may have already rolled back transaction after error
+        }
+    }
+}
+
+void Transaction::commit()
+{
+    assert(! _finished);
+    _db.execute("COMMIT");
+    _finished = true;
+}
+
+void migrateDatabase(Database& db, const char* const migrations[], int numOfMigrations)
+{
+    Query<int> userVersion(db, "PRAGMA user_version");
+    userVersion.execute();
+    int version = 0;
+    if (! userVersion.next(version))
+    {
+        throw std::runtime_error("Can't read database schema version");
+    }
+    while (userVersion.next(version)) { }
+
+    if (version > numOfMigrations)
+    {
+        throw std::runtime_error(concat("Database schema version ", version, " is newer than supported ", numOfMigrations));
+    }
+    for (; version < numOfMigrations; ++version)
+    {
+        Transaction transaction(db, TransactionType_IMMEDIATE);
+        db.execute(migrations[version]);
+        db.execute(concat("PRAGMA user_version = ", version + 1));
+        transaction.commit();
+    }
+}
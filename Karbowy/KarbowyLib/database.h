@@ -7,6 +7,7 @@
 #include <string>
 #include <exception>
 #include <memory>
+#include <map>
 #include <type_traits>
 #include <boost/optional.hpp>
 #include <boost/variant.hpp>
@@ -92,15 +93,42 @@ private:
 };
 
 
+struct DatabaseConfig
+{
+    DatabaseConfig();
+
+    string _journalMode;
+    string _synchronous;
+    // in pages when positive, in KiB when negative, as in PRAGMA cache_size
+    int _cacheSize;
+    int64_t _mmapSize;
+    int _busyTimeoutMs;
+};
+
+class QueryBase;
+
 class Database
 {
 public:
 
     Database(const string &fileName);
+    Database(const string &fileName, const DatabaseConfig& config);
     Database(const Database&) = delete;
     ~Database();
+
+    void configure(const DatabaseConfig& config);
+    // executes statement(s) without parameters and results
+    void execute(const string& queryStr);
+    // resets statements prepared by statement(), including ones abandoned before their last row
+    void resetStatements();
+
+    // returns statement prepared on this connection, preparing it on first use;
+    // extra arguments are passed to QueryType constructor
+    template <typename QueryType, typename... CtorArgs>
+    QueryType& statement(const char* queryStr, CtorArgs&&... ctorArgs);
 private:
     sqlite3* _db;
+    std::map<string, unique_ptr<QueryBase>, std::less<> > _statements;
 
     const char* getErrorMsg(int errorCode);
     static const char* getErrorMsg(sqlite3* db, int erorCode);
@@ -113,6 +141,10 @@ class QueryBase
 {
 public:
     virtual ~QueryBase();
+
+    // abandons rows not retrieved yet; statement stopped before its last row keeps its
+    // snapshot of database, and transaction can't write after someone else wrote
+    void reset();
 protected:
     Database& _db;
     string _queryStr;
@@ -192,8 +224,7 @@ private:
     template <typename... RestOfArgs>
     void bind(int paramIdx, const Timestamp& param, RestOfArgs&&... restOfArgs)
     {
-        std::string str = formatTimestamp(param);
-        int errorCode = sqlite3_bind_text(_stmt, paramIdx, str.c_str(), str.length(), SQLITE_TRANSIENT);
+        int errorCode = sqlite3_bind_int64(_stmt, paramIdx, toEpochMilliseconds(param));
         checkBindError(errorCode, paramIdx, param);
         bind(paramIdx + 1, restOfArgs...);
     }
@@ -204,8 +235,7 @@ private:
         int errorCode;
         if (param)
         {
-            std::string str = formatTimestamp(*param);
-            errorCode = sqlite3_bind_text(_stmt, paramIdx, str.c_str(), str.length(), SQLITE_TRANSIENT);
+            errorCode = sqlite3_bind_int64(_stmt, paramIdx, toEpochMilliseconds(*param));
         }
         else
         {
@@ -253,6 +283,31 @@ private:
     }
 };
 
+// Applies migrations not yet applied to db, each in its own transaction. Number of
+// applied migrations is stored in PRAGMA user_version, so migrations may be only appended.
+void migrateDatabase(Database& db, const char* const migrations[], int numOfMigrations);
+
+enum TransactionType
+{
+    TransactionType_DEFERRED,
+    // takes write lock at the beginning, use for transactions that write
+    TransactionType_IMMEDIATE
+};
+
+// Rolls back on destruction unless commit() was called.
+class Transaction
+{
+public:
+    explicit Transaction(Database& db, TransactionType type = TransactionType_DEFERRED);
+    Transaction(const Transaction&) = delete;
+    ~Transaction();
+
+    void commit();
+private:
+    Database& _db;
+    bool _finished;
+};
+
 template <typename... Args>
 class Command : public QueryBase
 {
@@ -307,6 +362,9 @@ int retrieveIntColumn(sqlite3_stmt* stmt, int columnIdx);
 boost::optional<int> retrieveNullableIntColumn(sqlite3_stmt* stmt, int columnIdx);
 std::string retrieveStringColumn(sqlite3_stmt* stmt, int columnIdx);
 boost::optional<std::string> retrieveNullableStringColumn(sqlite3_stmt* stmt, int columnIdx);
+// timestamps are stored as milliseconds since epoch, text is accepted for not migrated rows
+Timestamp retrieveTimestampColumn(sqlite3_stmt* stmt, int columnIdx);
+boost::optional<Timestamp> retrieveNullableTimestampColumn(sqlite3_stmt* stmt, int columnIdx);
 
 template <typename Signature>
 struct CallFunctor;
@@ -405,10 +463,7 @@ struct CallFunctor<Result(Timestamp, RestOfArgs...)>
     template <typename Functor>
     static Result call(Functor&& fn, sqlite3_stmt* stmt, int columnIdx)
     {
-        std::string value = retrieveStringColumn(stmt, columnIdx);
-        Timestamp timestamp;
-        bool parseOk = parse(value, TimestampToken(timestamp));
-        assert(parseOk);
+        Timestamp timestamp = retrieveTimestampColumn(stmt, columnIdx);
         return CallFunctor<Result(RestOfArgs...)>::call(bind_first(std::move(fn), std::move(timestamp)),
                                                         stmt,
                                                         columnIdx + 1);
@@ -421,22 +476,10 @@ struct CallFunctor<Result(boost::optional<Timestamp>, RestOfArgs...)>
     template <typename Functor>
     static Result call(Functor&& fn, sqlite3_stmt* stmt, int columnIdx)
     {
-        boost::optional<std::string> value = retrieveNullableStringColumn(stmt, columnIdx);
-        if (value)
-        {
-            Timestamp timestamp;
-            bool parseOk = parse(*value, TimestampToken(timestamp));
-            assert(parseOk);
-            return CallFunctor<Result(RestOfArgs...)>::call(bind_first(std::move(fn), boost::optional<Timestamp>(timestamp)),
-                                                            stmt,
-                                                            columnIdx + 1);
-        }
-        else
-        {
-            return CallFunctor<Result(RestOfArgs...)>::call(bind_first(std::move(fn), boost::none),
-                                                            stmt,
-                                                            columnIdx + 1);
-        }
+        boost::optional<Timestamp> value = retrieveNullableTimestampColumn(stmt, columnIdx);
+        return CallFunctor<Result(RestOfArgs...)>::call(bind_first(std::move(fn), std::move(value)),
+                                                        stmt,
+                                                        columnIdx + 1);
     }
 };
 
@@ -616,5 +659,17 @@ private:
     }
 };
 
+template <typename QueryType, typename... CtorArgs>
+QueryType& Database::statement(const char* queryStr, CtorArgs&&... ctorArgs)
+{
+    auto found = _statements.find(queryStr);
+    if (found == _statements.end())
+    {
+        unique_ptr<QueryBase> query(new QueryType(*this, queryStr, std::forward<CtorArgs>(ctorArgs)...));
+        found = _statements.emplace(queryStr, std::move(query)).first;
+    }
+    assert(dynamic_cast<QueryType*>(found->second.get()));
+    return static_cast<QueryType&>(*found->second);
+}
 
 #endif // DATABASE_H
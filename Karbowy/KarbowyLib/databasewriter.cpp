@@ -0,0 +1,141 @@
+#include "databasewriter.h"
+#include "database.h"
+
+DatabaseWriter::DatabaseWriter(const ConnectionProvider& connection, size_t maxGroupSize) :
+    _connection(connection),
+    _maxGroupSize(maxGroupSize),
+    _stopping(false) { }
+
+DatabaseWriter::~DatabaseWriter()
+{
+    stop();
+}
+
+void DatabaseWriter::start()
+{
+    assert(! _thread.joinable());
+    _stopping = false;
+    _thread = std::thread(&DatabaseWriter::run, this);
+}
+
+void DatabaseWriter::stop()
+{
+    if (_thread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> guard(_mutex);
+            _stopping = true;
+        }
+        _condition.notify_one();
+        _thread.join();
+    }
+}
+
+std::future<void> DatabaseWriter::submit(const Job& job)
+{
+    return submit(job, CompletionHandler());
+}
+
+std::future<void> DatabaseWriter::submit(const Job& job, const CompletionHandler& onDone)
+{
+    std::future<void> result;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        assert(! _stopping);
+        _pending.emplace_back();
+        _pending.back()._job = job;
+        _pending.back()._onDone = onDone;
+        result = _pending.back()._promise.get_future();
+    }
+    _condition.notify_one();
+    return result;
+}
+
+void DatabaseWriter::execute(const Job& job)
+{
+    assert(std::this_thread::get_id() != _thread.get_id());
+    submit(job).get();
+}
+
+bool DatabaseWriter::takeGroup(std::deque<PendingJob>& group)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [this]() { return _stopping || ! _pending.empty(); });
+    while (! _pending.empty() && group.size() < _maxGroupSize)
+    {
+        group.emplace_back(std::move(_pending.front()));
+        _pending.pop_front();
+    }
+    return ! group.empty();
+}
+
+void DatabaseWriter::executeGroup(std::deque<PendingJob>& group)
+{
+    Database* connection = nullptr;
+    try
+    {
+        Database& db = _connection();
+        connection = &db;
+        Transaction transaction(db, TransactionType_IMMEDIATE);
+        for (auto& pending : group)
+        {
+            db.execute("SAVEPOINT job");
+            try
+            {
+                pending._job(db);
+                db.execute("RELEASE job");
+            }
+            catch (...)
+            {
+                pending._error = std::current_exception();
+                db.execute("ROLLBACK TO job");
+                db.execute("RELEASE job");
+            }
+        }
+        transaction.commit();
+    }
+    catch (...)
+    {
+        std::exception_ptr groupError = std::current_exception();
+        for (auto& pending : group)
+        {
+            if (! pending._error)
+            {
+                pending._error = groupError;
+            }
+        }
+    }
+    if (connection)
+    {
+        // job may have left query before its last row, next group couldn't begin after other connection wrote
+        connection->resetStatements();
+    }
+    for (auto& pending : group)
+    {
+        if (pending._onDone)
+        {
+            pending._onDone();
+        }
+        if (pending._error)
+        {
+            pending._promise.set_exception(pending._error);
+        }
+        else
+        {
+            pending._promise.set_value();
+        }
+    }
+}
+
+void DatabaseWriter::run()
+{
+    while (true)
+    {
+        std::deque<PendingJob> group;
+        if (! takeGroup(group))
+        {
+            break;
+        }
+        executeGroup(group);
+    }
+}
@@ -0,0 +1,63 @@
+#ifndef DATABASEWRITER_H
+#define DATABASEWRITER_H
+
+#include <functional>
+#include <future>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+class Database;
+
+// Executes all modifications of database on single thread. Jobs submitted while
+// previous group is being committed are executed together in one transaction,
+// each one in its own savepoint, so failing job doesn't affect others.
+class DatabaseWriter
+{
+public:
+    typedef std::function<void(Database&)> Job;
+    // called on writer thread to obtain connection used by jobs
+    typedef std::function<Database&()> ConnectionProvider;
+    // called on writer thread when job's group was committed or rolled back
+    typedef std::function<void()> CompletionHandler;
+
+    static const size_t DEFAULT_MAX_GROUP_SIZE = 256;
+
+    DatabaseWriter(const ConnectionProvider& connection, size_t maxGroupSize = DEFAULT_MAX_GROUP_SIZE);
+    DatabaseWriter(const DatabaseWriter&) = delete;
+    ~DatabaseWriter();
+
+    void start();
+    // executes everything already submitted, then stops writer thread
+    void stop();
+
+    std::future<void> submit(const Job& job);
+    // like above, onDone is called before returned future becomes ready
+    std::future<void> submit(const Job& job, const CompletionHandler& onDone);
+    // submits job and waits until its group is committed, rethrows job's exception
+    void execute(const Job& job);
+
+private:
+    struct PendingJob
+    {
+        Job _job;
+        CompletionHandler _onDone;
+        std::promise<void> _promise;
+        std::exception_ptr _error;
+    };
+
+    ConnectionProvider _connection;
+    size_t _maxGroupSize;
+    std::thread _thread;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<PendingJob> _pending;
+    bool _stopping;
+
+    bool takeGroup(std::deque<PendingJob>& group);
+    void executeGroup(std::deque<PendingJob>& group);
+    void run();
+};
+
+#endif // DATABASEWRITER_H
@@ -1,24 +1,37 @@
 #include "eventdispatcher.h"
 #include "systemerror.h"
 #include "concat.h"
-#include <sys/select.h>
+#include "framing.h"
+#include <algorithm>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
 #include <string.h>
 #include <assert.h>
 
 MainLoop::MainLoop() :
-    _run(false) { }
+    _epollFd(epoll_create1(EPOLL_CLOEXEC)),
+    _events(INITIAL_EVENTS_CAPACITY),
+    _numOfPendingEvents(0),
+    _run(false)
+{
+    if (_epollFd < 0)
+    {
+        throw SystemError("epoll_create error");
+    }
+}
 
 void MainLoop::addObject(WaitableObject& obj)
 {
     assert(obj._loop == nullptr);
 
-    auto res1 = _objects.insert(&obj);
-    assert(res1.second);
-    auto res2 = _descriptorsToObjects.insert(std::make_pair(obj.descriptor(), &obj));
-    assert(res2.second);
+    auto res = _objects.insert(&obj);
+    assert(res.second);
     obj._loop = this;
+    obj._registeredFor = 0;
+    obj._updateScheduled = false;
+    updateInterest(obj);
 }
 
 void MainLoop::removeObject(WaitableObject& obj)
@@ -27,8 +40,18 @@ void MainLoop::removeObject(WaitableObject& obj)
 
     size_t numOfRemovedObjects = _objects.erase(&obj);
     assert(numOfRemovedObjects == 1);
-    numOfRemovedObjects = _descriptorsToObjects.erase(obj.descriptor());
-    assert(numOfRemovedObjects == 1);
+    if (obj._registeredFor)
+    {
+        // descriptor might have been closed already, which removes it from epoll set anyway
+        epoll_ctl(_epollFd, EPOLL_CTL_DEL, obj.descriptor(), nullptr);
+        obj._registeredFor = 0;
+    }
+    if (obj._updateScheduled)
+    {
+        _dirtyObjects.erase(std::find(_dirtyObjects.begin(), _dirtyObjects.end(), &obj));
+        obj._updateScheduled = false;
+    }
+    forgetPendingEvents(obj);
     obj._loop = nullptr;
 }
 
@@ -45,55 +68,25 @@ void MainLoop::run()
 {
     while (_run)
     {
-        fd_set readDescriptors, writeDescriptors;
-        int maxFd = -1;
-        FD_ZERO(&readDescriptors);
-        FD_ZERO(&writeDescriptors);
-        for (auto obj : _objects)
+        applyScheduledUpdates();
+        int numOfEvents = epoll_wait(_epollFd, _events.data(), _events.size(), -1);
+        if (numOfEvents < 0)
         {
-            int whatToWaitFor = obj->_whatToWaitFor;
-            int fd = obj->descriptor();
-            if (whatToWaitFor & WaitableObject::WaitFor_READ)
-            {
-                FD_SET(fd, &readDescriptors);
-            }
-            if (whatToWaitFor & WaitableObject::WaitFor_WRITE)
-            {
-                FD_SET(fd, &writeDescriptors);
-            }
-            if (whatToWaitFor)
+            if (errno == EINTR)
             {
-                if (fd > maxFd)
-                {
-                    maxFd = fd;
-                }
+                continue;
             }
+            throw SystemError("epoll_wait error");
         }
-        if (select(maxFd + 1, &readDescriptors, &writeDescriptors, nullptr, nullptr) < 0)
+        _numOfPendingEvents = numOfEvents;
+        for (int i = 0; i < numOfEvents; ++i)
         {
-            throw SystemError("select error");
+            dispatch(_events[i]);
         }
-        for (int i = 0; i <= maxFd; ++i)
+        _numOfPendingEvents = 0;
+        if (static_cast<size_t>(numOfEvents) == _events.size())
         {
-            if (FD_ISSET(i, &readDescriptors))
-            {
-                auto it = _descriptorsToObjects.find(i);
-                if (it != _descriptorsToObjects.end())
-                {
-                    it->second->handleReadyToRead();
-                }
-            }
-        }
-        for (int i = 0; i <= maxFd; ++i)
-        {
-            if (FD_ISSET(i, &writeDescriptors))
-            {
-                auto it = _descriptorsToObjects.find(i);
-                if (it != _descriptorsToObjects.end())
-                {
-                    it->second->handleReadyToWrite();
-                }
-            }
+            _events.resize(2 * _events.size());
         }
     }
 }
@@ -108,9 +101,105 @@ void MainLoop::exit()
     _run = false;
 }
 
+void MainLoop::scheduleUpdate(WaitableObject& obj)
+{
+    assert(obj._loop == this);
+
+    if (! obj._updateScheduled)
+    {
+        obj._updateScheduled = true;
+        _dirtyObjects.push_back(&obj);
+    }
+}
+
+void MainLoop::updateInterest(WaitableObject& obj)
+{
+    int whatToWaitFor = obj._whatToWaitFor;
+    if (whatToWaitFor == obj._registeredFor)
+    {
+        return;
+    }
+
+    // Objects which don't wait for anything are taken out of epoll set altogether,
+    // otherwise EPOLLHUP/EPOLLERR would be reported for them on every iteration.
+    int op;
+    if (! obj._registeredFor)
+    {
+        op = EPOLL_CTL_ADD;
+    }
+    else if (! whatToWaitFor)
+    {
+        op = EPOLL_CTL_DEL;
+    }
+    else
+    {
+        op = EPOLL_CTL_MOD;
+    }
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = whatToWaitFor;
+    event.data.ptr = &obj;
+    if (epoll_ctl(_epollFd, op, obj.descriptor(), &event) < 0)
+    {
+        throw SystemError("epoll_ctl error");
+    }
+    obj._registeredFor = whatToWaitFor;
+}
+
+void MainLoop::applyScheduledUpdates()
+{
+    for (auto obj : _dirtyObjects)
+    {
+        obj->_updateScheduled = false;
+        updateInterest(*obj);
+    }
+    _dirtyObjects.clear();
+}
+
+void MainLoop::dispatch(epoll_event& event)
+{
+    WaitableObject* obj = static_cast<WaitableObject*>(event.data.ptr);
+    if (! obj)
+    {
+        // object was removed by handler of some earlier event
+        return;
+    }
+    int ready = event.events;
+    if (ready & (EPOLLERR | EPOLLHUP))
+    {
+        // let the object discover the error on its own in read/write handler
+        ready |= obj->_registeredFor;
+    }
+    if ((ready & WaitableObject::WaitFor_READ) && (obj->_whatToWaitFor & WaitableObject::WaitFor_READ))
+    {
+        obj->handleReadyToRead();
+    }
+    if (! event.data.ptr)
+    {
+        return;
+    }
+    if ((ready & WaitableObject::WaitFor_WRITE) && (obj->_whatToWaitFor & WaitableObject::WaitFor_WRITE))
+    {
+        obj->handleReadyToWrite();
+    }
+}
+
+void MainLoop::forgetPendingEvents(WaitableObject& obj)
+{
+    for (int i = 0; i < _numOfPendingEvents; ++i)
+    {
+        if (_events[i].data.ptr == &obj)
+        {
+            _events[i].data.ptr = nullptr;
+        }
+    }
+}
+
 WaitableObject::WaitableObject() :
     _loop(nullptr),
-    _whatToWaitFor(0) { }
+    _whatToWaitFor(0),
+    _registeredFor(0),
+    _updateScheduled(false) { }
 
 WaitableObject::~WaitableObject()
 {
@@ -125,12 +214,22 @@ void WaitableObject::detach()
     }
 }
 
+void WaitableObject::waitFor(WaitFor what)
+{
+    _whatToWaitFor |= what;
+    if (_loop)
+    {
+        _loop->scheduleUpdate(*this);
+    }
+}
+
 void WaitableObject::handleReadyToRead()
 {
     assert(_loop);
     assert(_whatToWaitFor & WaitFor_READ);
 
     _whatToWaitFor &= ~WaitFor_READ;
+    _loop->scheduleUpdate(*this);
     onReadyToRead();
 }
 
@@ -140,12 +239,22 @@ void WaitableObject::handleReadyToWrite()
     assert(_whatToWaitFor & WaitFor_WRITE);
 
     _whatToWaitFor &= ~WaitFor_WRITE;
+    _loop->scheduleUpdate(*this);
     onReadyToWrite();
 }
 
 AsyncSocket::AsyncSocket(const ErrorHandler& errorHandler) :
     _state(State_BEFORE_CONNECTION),
-    _errorHandler(errorHandler) { }
+    _outputOffset(0),
+    _errorHandler(errorHandler),
+    _lifeToken(std::make_shared<char>()) { }
+
+AsyncSocket::AsyncSocket(Descriptor&& fd, const ErrorHandler& errorHandler) :
+    _state(State_CONNECTED),
+    _fd(std::move(fd)),
+    _outputOffset(0),
+    _errorHandler(errorHandler),
+    _lifeToken(std::make_shared<char>()) { }
 
 bool AsyncSocket::asyncConnect(const Ipv4Address &address, const ConnectHandler &handler)
 {
@@ -157,11 +266,15 @@ bool AsyncSocket::asyncConnect(const Ipv4Address &address, const ConnectHandler
         handleError("IPv4 socket error", errno);
         return false;
     }
+    if (! _fd.setNoDelay())
+    {
+        handleError("IPv4 setsockopt error", errno);
+        return false;
+    }
     int err = connect(_fd, address.address(), address.length());
     if (err >= 0)
     {
-        _state = State_CONNECTED;
-        handler();
+        onConnected(handler);
         return true;
     }
     else
@@ -170,7 +283,7 @@ bool AsyncSocket::asyncConnect(const Ipv4Address &address, const ConnectHandler
         {
             _state = State_CONNECTING;
             _connectHandler = handler;
-            _whatToWaitFor |= WaitFor_WRITE;
+            waitFor(WaitFor_WRITE);
             return true;
         }
         else
@@ -191,11 +304,15 @@ bool AsyncSocket::asyncConnect(const Ipv6Address &address, const ConnectHandler
         handleError("IPv6 socket error", errno);
         return false;
     }
+    if (! _fd.setNoDelay())
+    {
+        handleError("IPv6 setsockopt error", errno);
+        return false;
+    }
     int err = connect(_fd, address.address(), address.length());
     if (err >= 0)
     {
-        _state = State_CONNECTED;
-        handler();
+        onConnected(handler);
         return true;
     }
     else
@@ -204,7 +321,7 @@ bool AsyncSocket::asyncConnect(const Ipv6Address &address, const ConnectHandler
         {
             _state = State_CONNECTING;
             _connectHandler = handler;
-            _whatToWaitFor |= WaitFor_WRITE;
+            waitFor(WaitFor_WRITE);
             return true;
         }
         else
@@ -219,6 +336,7 @@ void AsyncSocket::asyncReadLine(const ReadHandler& handler)
 {
     assert(_state == State_CONNECTED || _state == State_AFTER_CONNECTION);
 
+    _frameHandler = FrameHandler();
     if (_inputBuffer.hasFullLine())
     {
         handler(_inputBuffer.getFirstLine());
@@ -230,26 +348,96 @@ void AsyncSocket::asyncReadLine(const ReadHandler& handler)
     else
     {
         _readHandler = handler;
-        _whatToWaitFor |= WaitFor_READ;
+        waitFor(WaitFor_READ);
     }
 }
 
-void AsyncSocket::asyncWrite(const std::string& str, const WriteHandler& handler)
+bool AsyncSocket::readBufferedLine(std::string& line)
 {
-    _outputBuffer.insert(_outputBuffer.end(), str.begin(), str.end());
-    switch (writeWhilePossible())
+    if (_inputBuffer.hasFullLine())
     {
-    case WriteResult_COMPLETE:
-        handler();
-        break;
-    case WriteResult_INCOMPLETE:
-        _writeHandler = handler;
-        _whatToWaitFor |= WaitFor_WRITE;
-        break;
-    case WriteResult_ERROR:
-        break;
-    default:
-        assert(false);
+        boost::string_view view = _inputBuffer.getFirstLineView();
+        // reuses capacity of line
+        line.assign(view.data(), view.size());
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+void AsyncSocket::asyncReadFrame(const FrameHandler& handler)
+{
+    assert(_state == State_CONNECTED || _state == State_AFTER_CONNECTION);
+
+    _readHandler = ReadHandler();
+    _frameHandler = handler;
+    if (! dispatchInput())
+    {
+        waitFor(WaitFor_READ);
+    }
+}
+
+bool AsyncSocket::readBufferedFrame(boost::string_view& payload)
+{
+    if (_inputBuffer.hasFullFrame() && _inputBuffer.firstFrameSize() <= MAX_FRAME_SIZE)
+    {
+        payload = _inputBuffer.getFirstFrameView();
+        return true;
+    }
+    else
+    {
+        return false;
+    }
+}
+
+bool AsyncSocket::dispatchInput()
+{
+    if (_frameHandler)
+    {
+        if (_inputBuffer.hasFrameHeader() && _inputBuffer.firstFrameSize() > MAX_FRAME_SIZE)
+        {
+            handleError("frame too large", EMSGSIZE);
+            return true;
+        }
+        if (_inputBuffer.hasFullFrame())
+        {
+            FrameHandler handler = std::move(_frameHandler);
+            _frameHandler = FrameHandler();
+            handler(_inputBuffer.getFirstFrameView());
+            return true;
+        }
+        if (_inputBuffer.eofReceived())
+        {
+            handleEof();
+            return true;
+        }
+        return false;
+    }
+    else
+    {
+        if (_inputBuffer.isEof())
+        {
+            handleEof();
+            return true;
+        }
+        if (_inputBuffer.hasFullLine())
+        {
+            _readHandler(_inputBuffer.getFirstLine());
+            return true;
+        }
+        return false;
+    }
+}
+
+void AsyncSocket::asyncWrite(std::string data, const WriteHandler& handler)
+{
+    bool writeInProgress = ! _outputQueue.empty();
+    _outputQueue.push_back(PendingWrite { std::move(data), handler });
+    if (! writeInProgress && _state == State_CONNECTED)
+    {
+        writeQueued();
     }
 }
 
@@ -260,14 +448,14 @@ int AsyncSocket::descriptor() const
 
 void AsyncSocket::onReadyToRead()
 {
-    static const size_t chunkSize = 1024;
+    static const size_t chunkSize = 4096;
     ssize_t bytesRead;
     do {
-        char chunk[chunkSize];
+        char* chunk = _inputBuffer.prepare(chunkSize);
         bytesRead = read(_fd, chunk, chunkSize);
         if (bytesRead > 0)
         {
-            _inputBuffer.addData(chunk, bytesRead);
+            _inputBuffer.commit(bytesRead);
         }
         else if (bytesRead == 0)
         {
@@ -283,17 +471,9 @@ void AsyncSocket::onReadyToRead()
         }
     }
     while (bytesRead > 0);
-    if (_inputBuffer.isEof())
-    {
-        handleEof();
-    }
-    else if (_inputBuffer.hasFullLine())
+    if (! dispatchInput())
     {
-        _readHandler(_inputBuffer.getFirstLine());
-    }
-    else
-    {
-        _whatToWaitFor |= WaitFor_READ;
+        waitFor(WaitFor_READ);
     }
 }
 
@@ -304,30 +484,29 @@ void AsyncSocket::onReadyToWrite()
     case State_CONNECTING:
         if (! detectError())
         {
-            _state = State_CONNECTED;
-            _connectHandler();
+            onConnected(_connectHandler);
         }
         break;
     case State_CONNECTED:
-        switch (writeWhilePossible())
-        {
-        case WriteResult_COMPLETE:
-            _writeHandler();
-            break;
-        case WriteResult_INCOMPLETE:
-            _whatToWaitFor |= WaitFor_WRITE;
-            break;
-        case WriteResult_ERROR:
-            break;
-        default:
-            assert(false);
-        }
+        writeQueued();
         break;
     default:
         assert(false);
     }
 }
 
+void AsyncSocket::onConnected(ConnectHandler handler)
+{
+    _state = State_CONNECTED;
+    std::weak_ptr<char> alive = _lifeToken;
+    handler();
+    // writes queued before connection was established haven't been started by asyncWrite
+    if (! alive.expired() && _state == State_CONNECTED && ! _outputQueue.empty())
+    {
+        writeQueued();
+    }
+}
+
 bool AsyncSocket::detectError()
 {
     int error = 0;
@@ -350,22 +529,92 @@ bool AsyncSocket::detectError()
 
 AsyncSocket::WriteResult AsyncSocket::writeWhilePossible()
 {
-    ssize_t bytesWritten = 0;
-    while (! _outputBuffer.empty() && bytesWritten >= 0)
+    static const size_t MAX_IOVECS = 64;
+
+    while (! _outputQueue.empty())
     {
-        bytesWritten = write(_fd, &_outputBuffer.front(), _outputBuffer.size());
-        if (bytesWritten >= 0)
+        iovec iov[MAX_IOVECS];
+        size_t numOfIovecs = 0;
+        size_t offset = _outputOffset;
+        for (auto it = _outputQueue.begin(); it != _outputQueue.end() && numOfIovecs < MAX_IOVECS; ++it)
         {
-            _outputBuffer.erase(_outputBuffer.begin(), _outputBuffer.begin() + bytesWritten);
+            iov[numOfIovecs].iov_base = const_cast<char*>(it->_data.data()) + offset;
+            iov[numOfIovecs].iov_len = it->_data.size() - offset;
+            ++numOfIovecs;
+            offset = 0;
         }
-        else if (errno != EAGAIN && errno != EWOULDBLOCK)
+        // peer may have closed connection, EPIPE is reported as write error instead of SIGPIPE
+        msghdr msg = msghdr();
+        msg.msg_iov = iov;
+        msg.msg_iovlen = numOfIovecs;
+        ssize_t bytesWritten = sendmsg(_fd, &msg, MSG_NOSIGNAL);
+        if (bytesWritten < 0)
         {
-            handleError("write error", errno);
-            return WriteResult_ERROR;
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            else if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return WriteResult_INCOMPLETE;
+            }
+            else
+            {
+                handleError("write error", errno);
+                return WriteResult_ERROR;
+            }
+        }
+        size_t remaining = bytesWritten;
+        while (remaining > 0)
+        {
+            PendingWrite& front = _outputQueue.front();
+            size_t left = front._data.size() - _outputOffset;
+            if (remaining < left)
+            {
+                _outputOffset += remaining;
+                break;
+            }
+            remaining -= left;
+            _outputOffset = 0;
+            _completedWrites.push_back(std::move(front._handler));
+            _outputQueue.pop_front();
+        }
+        // empty writes are complete without writing anything
+        while (! _outputQueue.empty() && _outputQueue.front()._data.size() == _outputOffset)
+        {
+            _outputOffset = 0;
+            _completedWrites.push_back(std::move(_outputQueue.front()._handler));
+            _outputQueue.pop_front();
         }
     }
+    return WriteResult_COMPLETE;
+}
 
-    return _outputBuffer.empty() ? WriteResult_COMPLETE : WriteResult_INCOMPLETE;
+void AsyncSocket::writeQueued()
+{
+    WriteResult result = writeWhilePossible();
+    if (result == WriteResult_ERROR)
+    {
+        return;
+    }
+    if (result == WriteResult_INCOMPLETE)
+    {
+        waitFor(WaitFor_WRITE);
+    }
+    std::vector<WriteHandler> completed;
+    completed.swap(_completedWrites);
+    std::weak_ptr<char> alive = _lifeToken;
+    for (const auto& handler : completed)
+    {
+        if (alive.expired())
+        {
+            break;
+        }
+        if (handler)
+        {
+            handler();
+        }
+    }
 }
 
 void AsyncSocket::handleError(const std::string& errorMsg, int errorCode)
@@ -378,6 +627,49 @@ void AsyncSocket::handleEof()
     _errorHandler("EOF");
 }
 
+AsyncListener::AsyncListener(Listener& listener, const AcceptHandler& onAccept, const ErrorHandler& onError) :
+    _listener(listener),
+    _acceptHandler(onAccept),
+    _errorHandler(onError)
+{
+    int flags = fcntl(_listener.descriptor(), F_GETFL);
+    if (flags < 0 || fcntl(_listener.descriptor(), F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        throw SystemError("fcntl error");
+    }
+    waitFor(WaitFor_READ);
+}
+
+int AsyncListener::descriptor() const
+{
+    return _listener.descriptor();
+}
+
+void AsyncListener::onReadyToRead()
+{
+    try
+    {
+        while (true)
+        {
+            Descriptor fd = _listener.tryAccept();
+            if (fd < 0)
+            {
+                break;
+            }
+            _acceptHandler(std::move(fd));
+        }
+    }
+    catch (std::exception& ex)
+    {
+        _errorHandler(ex.what());
+    }
+    waitFor(WaitFor_READ);
+}
+
+void AsyncListener::onReadyToWrite()
+{
+    assert(false);
+}
 
 TaskQueue::TaskQueue()
 {
@@ -392,7 +684,7 @@ TaskQueue::TaskQueue()
     {
         throw SystemError("fcntl error");
     }
-    _whatToWaitFor |= WaitFor_READ;
+    waitFor(WaitFor_READ);
 }
 
 void TaskQueue::addTask(const std::function<void()>& task)
@@ -424,7 +716,7 @@ void TaskQueue::onReadyToRead()
     {
         task();
     }
-    _whatToWaitFor |= WaitFor_READ;
+    waitFor(WaitFor_READ);
 }
 
 std::function<void()> TaskQueue::getTask()
@@ -4,9 +4,9 @@
 #include "sockets.h"
 #include <vector>
 #include <deque>
-#include <map>
 #include <set>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <atomic>
 #include <sys/epoll.h>
@@ -24,9 +24,23 @@ public:
    void exit();
    void run();
 private:
+   static const int INITIAL_EVENTS_CAPACITY = 64;
+
+   Descriptor _epollFd;
    std::set <WaitableObject*> _objects;
-   std::map<int, WaitableObject*> _descriptorsToObjects;
+   // objects whose _whatToWaitFor may differ from interest registered in epoll
+   std::vector<WaitableObject*> _dirtyObjects;
+   std::vector<epoll_event> _events;
+   int _numOfPendingEvents;
    std::atomic<bool> _run;
+
+   void scheduleUpdate(WaitableObject& object);
+   void updateInterest(WaitableObject& object);
+   void applyScheduledUpdates();
+   void dispatch(epoll_event& event);
+   void forgetPendingEvents(WaitableObject& object);
+
+   friend class WaitableObject;
 };
 
 class WaitableObject
@@ -45,7 +59,13 @@ protected:
     MainLoop* _loop;
     int _whatToWaitFor;
 
+    void waitFor(WaitFor what);
+
 private:
+    // interest currently registered in MainLoop's epoll set
+    int _registeredFor;
+    bool _updateScheduled;
+
     // interface for MainLoop:
     virtual int descriptor() const = 0;
     void handleReadyToRead();
@@ -64,12 +84,23 @@ public:
     typedef std::function<void()> ConnectHandler;
     typedef std::function<void(const std::string&)> ReadHandler;
     typedef std::function<void()> WriteHandler;
+    // payload of binary frame (see framing.h), valid only during the call
+    typedef std::function<void(boost::string_view)> FrameHandler;
 
     AsyncSocket(const ErrorHandler& onError);
+    // wraps already connected, non-blocking socket (e.g. returned by Listener::tryAccept)
+    AsyncSocket(Descriptor&& fd, const ErrorHandler& onError);
     bool asyncConnect(const Ipv4Address& address, const ConnectHandler& handler);
     bool asyncConnect(const Ipv6Address& address, const ConnectHandler& handler);
     void asyncReadLine(const ReadHandler& handler);
-    void asyncWrite(const std::string& line, const WriteHandler &handler);
+    // takes next line if it is already in input buffer, never waits nor calls handlers
+    bool readBufferedLine(std::string& line);
+    void asyncReadFrame(const FrameHandler& handler);
+    // frame counterpart of readBufferedLine, payload is valid until next read
+    bool readBufferedFrame(boost::string_view& payload);
+    // writes are queued and sent in order with writev, many of them may be pending at once;
+    // handler (if any) is called when its data was passed to the kernel
+    void asyncWrite(std::string data, const WriteHandler& handler = WriteHandler());
 private:
     enum State
     {
@@ -81,17 +112,30 @@ private:
 
     State _state;
     Descriptor _fd;
+    struct PendingWrite
+    {
+        std::string _data;
+        WriteHandler _handler;
+    };
+
     LineBuffer _inputBuffer;
-    std::vector<char> _outputBuffer;
+    std::deque<PendingWrite> _outputQueue;
+    // bytes of _outputQueue.front() already written
+    size_t _outputOffset;
+    std::vector<WriteHandler> _completedWrites;
     ErrorHandler _errorHandler;
     ConnectHandler _connectHandler;
     ReadHandler _readHandler;
-    WriteHandler _writeHandler;
+    FrameHandler _frameHandler;
+    // expires when socket is destroyed, handlers may destroy it
+    std::shared_ptr<char> _lifeToken;
 
     int descriptor() const override;
     void onReadyToRead() override;
     void onReadyToWrite() override;
 
+    // handler is copied, it may destroy the socket
+    void onConnected(ConnectHandler handler);
     bool detectError();
 
     enum WriteResult
@@ -102,8 +146,29 @@ private:
     };
 
     WriteResult writeWhilePossible();
+    void writeQueued();
     void handleError(const std::string& errorMsg, int errorCode);
     void handleEof();
+    // calls pending read or frame handler if there is enough data, returns false otherwise
+    bool dispatchInput();
+};
+
+class AsyncListener : public WaitableObject
+{
+public:
+    typedef std::function<void(Descriptor&&)> AcceptHandler;
+    typedef std::function<void(const std::string&)> ErrorHandler;
+
+    // switches listener to non-blocking mode
+    AsyncListener(Listener& listener, const AcceptHandler& onAccept, const ErrorHandler& onError);
+private:
+    Listener& _listener;
+    AcceptHandler _acceptHandler;
+    ErrorHandler _errorHandler;
+
+    int descriptor() const override;
+    void onReadyToRead() override;
+    void onReadyToWrite() override;
 };
 
 class TaskQueue : public WaitableObject
@@ -0,0 +1,215 @@
+#include "framing.h"
+#include "task.h"
+#include <stdexcept>
+#include <limits>
+#include <type_traits>
+#include <assert.h>
+
+template <typename T>
+static void appendInt(std::string& out, T value)
+{
+    typedef typename std::make_unsigned<T>::type Unsigned;
+    Unsigned bits = static_cast<Unsigned>(value);
+    char bytes[sizeof(T)];
+    for (size_t i = sizeof(T); i > 0; --i)
+    {
+        bytes[i - 1] = static_cast<char>(bits & 0xFF);
+        bits >>= 8;
+    }
+    out.append(bytes, sizeof(T));
+}
+
+template <typename T>
+static bool parseInt(boost::string_view& data, T& value)
+{
+    if (data.size() < sizeof(T))
+    {
+        return false;
+    }
+    typedef typename std::make_unsigned<T>::type Unsigned;
+    Unsigned bits = 0;
+    for (size_t i = 0; i < sizeof(T); ++i)
+    {
+        bits = (bits << 8) | static_cast<unsigned char>(data[i]);
+    }
+    value = static_cast<T>(bits);
+    data.remove_prefix(sizeof(T));
+    return true;
+}
+
+template <typename Length>
+static void appendString(std::string& out, const std::string& str)
+{
+    if (str.size() > std::numeric_limits<Length>::max())
+    {
+        throw std::length_error("String too long for binary record: '" + str + '\'');
+    }
+    appendInt(out, static_cast<Length>(str.size()));
+    out += str;
+}
+
+template <typename Length>
+static bool parseString(boost::string_view& data, std::string& str)
+{
+    Length length;
+    if (! parseInt(data, length) || data.size() < length)
+    {
+        return false;
+    }
+    str.assign(data.data(), length);
+    data.remove_prefix(length);
+    return true;
+}
+
+size_t beginFrame(std::string& out)
+{
+    size_t frameStart = out.size();
+    out.append(FRAME_HEADER_SIZE, '\0');
+    return frameStart;
+}
+
+void endFrame(std::string& out, size_t frameStart)
+{
+    size_t length = out.size() - frameStart - FRAME_HEADER_SIZE;
+    assert(length <= MAX_FRAME_SIZE);
+    for (size_t i = FRAME_HEADER_SIZE; i > 0; --i)
+    {
+        out[frameStart + i - 1] = static_cast<char>(length & 0xFF);
+        length >>= 8;
+    }
+}
+
+void appendEmptyFrame(std::string& out)
+{
+    out.append(FRAME_HEADER_SIZE, '\0');
+}
+
+size_t parseFrameHeader(const char* header)
+{
+    boost::string_view data(header, FRAME_HEADER_SIZE);
+    uint32_t length = 0;
+    parseInt(data, length);
+    return length;
+}
+
+void appendLogEntryRecord(std::string& out, const LogEntry& entry)
+{
+    appendInt(out, toEpochMilliseconds(entry._timestamp));
+    appendInt(out, static_cast<int32_t>(entry._taskId ? *entry._taskId : -1));
+    appendInt(out, static_cast<uint8_t>(entry._type));
+    appendString<uint8_t>(out, entry._userId);
+}
+
+bool parseLogEntryRecord(boost::string_view& data, LogEntry& entry)
+{
+    int64_t timestamp;
+    int32_t taskId;
+    uint8_t type;
+    if (! parseInt(data, timestamp) ||
+        ! parseInt(data, taskId) ||
+        ! parseInt(data, type) ||
+        ! parseString<uint8_t>(data, entry._userId))
+    {
+        return false;
+    }
+    entry._timestamp = fromEpochMilliseconds(timestamp);
+    switch (type)
+    {
+    case LogEntryType_LOGIN:
+    case LogEntryType_LOGOUT:
+        if (taskId != -1)
+        {
+            return false;
+        }
+        entry._taskId = boost::none;
+        break;
+    case LogEntryType_TASK_START:
+    case LogEntryType_TASK_PAUSE:
+    case LogEntryType_TASK_FINISH:
+        if (taskId < 0)
+        {
+            return false;
+        }
+        entry._taskId = taskId;
+        break;
+    default:
+        return false;
+    }
+    entry._type = static_cast<LogEntryType>(type);
+    return true;
+}
+
+void appendSequencedLogEntryRecord(std::string& out, int sequence, const LogEntry& entry)
+{
+    appendInt(out, static_cast<int32_t>(sequence));
+    appendLogEntryRecord(out, entry);
+}
+
+bool parseSequencedLogEntryRecord(boost::string_view& data, int& sequence, LogEntry& entry)
+{
+    int32_t seq;
+    if (! parseInt(data, seq) ||
+        ! parseLogEntryRecord(data, entry))
+    {
+        return false;
+    }
+    sequence = seq;
+    return true;
+}
+
+void appendTaskRecord(std::string& out, const ClientTask& task)
+{
+    appendInt(out, static_cast<int32_t>(task._id));
+    appendInt(out, static_cast<int64_t>(toSeconds(task._timeSpent)));
+    appendString<uint16_t>(out, task._title);
+    if (task._description.size() > std::numeric_limits<uint16_t>::max())
+    {
+        throw std::length_error("Task description too long for binary record");
+    }
+    appendInt(out, static_cast<uint16_t>(task._description.size()));
+    for (const auto& line : task._description)
+    {
+        appendString<uint16_t>(out, line);
+    }
+}
+
+bool parseTaskRecord(boost::string_view& data, ClientTask& task)
+{
+    int32_t id;
+    int64_t seconds;
+    uint16_t numOfLines;
+    if (! parseInt(data, id) ||
+        ! parseInt(data, seconds) ||
+        ! parseString<uint16_t>(data, task._title) ||
+        ! parseInt(data, numOfLines))
+    {
+        return false;
+    }
+    task._id = id;
+    task._timeSpent = std::chrono::seconds(seconds);
+    task._description.resize(numOfLines);
+    for (auto& line : task._description)
+    {
+        if (! parseString<uint16_t>(data, line))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void appendRemovedTaskRecord(std::string& out, int taskId)
+{
+    appendInt(out, static_cast<int32_t>(taskId));
+}
+
+bool parseRemovedTaskRecord(boost::string_view& data, int& taskId)
+{
+    int32_t id;
+    if (! parseInt(data, id))
+    {
+        return false;
+    }
+    taskId = id;
+    return true;
+}
@@ -0,0 +1,43 @@
+#ifndef FRAMING_H
+#define FRAMING_H
+
+#include "logentry.h"
+#include <string>
+#include <boost/utility/string_view.hpp>
+
+class ClientTask;
+
+// Binary framing, used instead of text lines for bulk data (task lists and log uploads)
+// when both sides agreed on it with "FRAMING BINARY" command.
+//
+// Frame is 32-bit payload length followed by payload; empty frame ends a sequence of frames.
+// Payload is a concatenation of records, all integers are big-endian:
+//   log entry: 64-bit timestamp (milliseconds since epoch), 32-bit task id (-1 if none),
+//              8-bit LogEntryType, 8-bit user id length, user id
+//   sequenced log entry (LOG UPLOAD RESUMABLE): 32-bit sequence number, log entry
+//   task:      32-bit id, 64-bit seconds spent, 16-bit title length, title,
+//              16-bit number of description lines, each line as 16-bit length and bytes
+//   removed task: 32-bit id
+
+static const size_t FRAME_HEADER_SIZE = 4;
+static const size_t MAX_FRAME_SIZE = 1024 * 1024;
+
+// appends frame header with placeholder length, returns its position for endFrame
+size_t beginFrame(std::string& out);
+// fills length of frame started at frameStart with everything appended after its header
+void endFrame(std::string& out, size_t frameStart);
+void appendEmptyFrame(std::string& out);
+// payload length from frame header, header must have FRAME_HEADER_SIZE bytes
+size_t parseFrameHeader(const char* header);
+
+void appendLogEntryRecord(std::string& out, const LogEntry& entry);
+void appendSequencedLogEntryRecord(std::string& out, int sequence, const LogEntry& entry);
+void appendTaskRecord(std::string& out, const ClientTask& task);
+void appendRemovedTaskRecord(std::string& out, int taskId);
+// parse records from the front of data and remove them from it, return false if data is malformed
+bool parseLogEntryRecord(boost::string_view& data, LogEntry& entry);
+bool parseSequencedLogEntryRecord(boost::string_view& data, int& sequence, LogEntry& entry);
+bool parseTaskRecord(boost::string_view& data, ClientTask& task);
+bool parseRemovedTaskRecord(boost::string_view& data, int& taskId);
+
+#endif // FRAMING_H
@@ -1,58 +1,137 @@
 #include "linebuffer.h"
+#include "framing.h"
 
 #include <string.h>
 #include <stdexcept>
 #include <assert.h>
+#include <algorithm>
+
+static const size_t INITIAL_CAPACITY = 4096;
 
 LineBuffer::LineBuffer() :
-    _lastLineComplete(true),
+    _readPos(0),
+    _writePos(0),
+    _delimiterPos(0),
     _eofReceived(false) { }
 
 bool LineBuffer::hasFullLine() const
 {
-    size_t size = _lines.size();
-    return size > 1 || (size > 0 && _lastLineComplete);
+    return _delimiterPos < _writePos || (_eofReceived && _readPos < _writePos);
 }
 
 bool LineBuffer::isEof() const
 {
-    return _eofReceived && _lines.empty();
+    return _eofReceived && _readPos == _writePos;
+}
+
+bool LineBuffer::eofReceived() const
+{
+    return _eofReceived;
+}
+
+bool LineBuffer::hasFrameHeader() const
+{
+    return _writePos - _readPos >= FRAME_HEADER_SIZE;
+}
+
+size_t LineBuffer::firstFrameSize() const
+{
+    assert(hasFrameHeader());
+    return parseFrameHeader(_data.data() + _readPos);
+}
+
+bool LineBuffer::hasFullFrame() const
+{
+    return hasFrameHeader() && _writePos - _readPos - FRAME_HEADER_SIZE >= firstFrameSize();
+}
+
+boost::string_view LineBuffer::getFirstFrameView()
+{
+    assert(hasFullFrame());
+    size_t size = firstFrameSize();
+    boost::string_view payload(_data.data() + _readPos + FRAME_HEADER_SIZE, size);
+    _readPos += FRAME_HEADER_SIZE + size;
+    if (_delimiterPos < _readPos)
+    {
+        findDelimiter(_readPos);
+    }
+    return payload;
 }
 
 std::string LineBuffer::getFirstLine()
+{
+    boost::string_view line = getFirstLineView();
+    return std::string(line.data(), line.size());
+}
+
+boost::string_view LineBuffer::getFirstLineView()
 {
     assert(hasFullLine());
-    std::string line = _lines.front();
-    _lines.pop_front();
+    boost::string_view line(_data.data() + _readPos, _delimiterPos - _readPos);
+    if (_delimiterPos < _writePos)
+    {
+        _readPos = _delimiterPos + 1;
+        findDelimiter(_readPos);
+    }
+    else
+    {
+        // last line without delimiter before EOF
+        _readPos = _writePos;
+    }
     return line;
 }
 
 void LineBuffer::addData(const char* data, size_t size)
+{
+    if (size > 0)
+    {
+        memcpy(prepare(size), data, size);
+        commit(size);
+    }
+}
+
+char* LineBuffer::prepare(size_t size)
 {
     assert(! _eofReceived);
 
-    while (size > 0)
+    if (_readPos == _writePos)
     {
-        if (_lastLineComplete)
-        {
-            _lines.push_back(std::string());
-        }
-        std::string& target = _lines.back();
-        const char* delimeter = static_cast<const char*>(memchr(data, '\n', size));
-        if (delimeter)
+        _readPos = _writePos = _delimiterPos = 0;
+    }
+    if (_data.size() - _writePos < size)
+    {
+        size_t unread = _writePos - _readPos;
+        if (_readPos > 0)
         {
-            target.insert(target.end(), data, delimeter);
-            _lastLineComplete = true;
-            size -= delimeter - data + 1;
-            data = delimeter + 1;
+            memmove(_data.data(), _data.data() + _readPos, unread);
+            _delimiterPos -= _readPos;
+            _writePos = unread;
+            _readPos = 0;
         }
-        else
+        if (_data.size() - _writePos < size)
         {
-            target.insert(target.end(), data, data + size);
-            _lastLineComplete = false;
-            size = 0;
+            size_t capacity = std::max(_data.size(), INITIAL_CAPACITY);
+            while (capacity - _writePos < size)
+            {
+                capacity *= 2;
+            }
+            _data.resize(capacity);
         }
     }
+    return _data.data() + _writePos;
+}
+
+void LineBuffer::commit(size_t size)
+{
+    assert(! _eofReceived);
+    assert(_writePos + size <= _data.size());
+
+    size_t oldWritePos = _writePos;
+    _writePos += size;
+    if (_delimiterPos == oldWritePos)
+    {
+        findDelimiter(oldWritePos);
+    }
 }
 
 void LineBuffer::setEof()
@@ -60,6 +139,16 @@ void LineBuffer::setEof()
     assert(! _eofReceived);
 
     _eofReceived = true;
-    _lastLineComplete = true;
 }
 
+void LineBuffer::findDelimiter(size_t from)
+{
+    if (from == _writePos)
+    {
+        _delimiterPos = _writePos;
+        return;
+    }
+    const char* begin = _data.data() + from;
+    const char* delimiter = static_cast<const char*>(memchr(begin, '\n', _writePos - from));
+    _delimiterPos = delimiter ? delimiter - _data.data() : _writePos;
+}
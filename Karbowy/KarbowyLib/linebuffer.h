@@ -2,8 +2,11 @@
 #define LINEBUFFER_H
 
 #include <string>
-#include <deque>
+#include <vector>
+#include <boost/utility/string_view.hpp>
 
+// Received bytes are kept in single contiguous buffer, lines are handed out as views into it.
+// Delimiters are searched with memchr, every byte is scanned only once.
 class LineBuffer
 {
 public:
@@ -15,14 +18,36 @@ public:
 
     bool hasFullLine() const;
     std::string getFirstLine();
+    // returned view is valid until next call of addData or prepare
+    boost::string_view getFirstLineView();
     bool isEof() const;
+    // true if stream ended, possibly with unread data still in buffer
+    bool eofReceived() const;
+
+    // binary frames (see framing.h) can be interleaved with lines
+    bool hasFrameHeader() const;
+    // payload length of first frame, valid if hasFrameHeader()
+    size_t firstFrameSize() const;
+    bool hasFullFrame() const;
+    // returns payload of first frame, valid until next call of addData or prepare
+    boost::string_view getFirstFrameView();
 
     void addData(const char* data, size_t size);
+    // returns space for at least size bytes, to be read directly into,
+    // commit tells how many of them were actually written
+    char* prepare(size_t size);
+    void commit(size_t size);
     void setEof();
 private:
-    std::deque<std::string> _lines;
-    bool _lastLineComplete;
+    std::vector<char> _data;
+    // unread bytes are in [_readPos, _writePos)
+    size_t _readPos;
+    size_t _writePos;
+    // first delimiter in unread bytes or _writePos if there is none
+    size_t _delimiterPos;
     bool _eofReceived;
+
+    void findDelimiter(size_t from);
 };
 
 
@@ -3,19 +3,37 @@
 
 #include "timestamp.h"
 #include <boost/algorithm/string.hpp>
+#include <type_traits>
+#include <string.h>
+#include <ctype.h>
 
-class Token
-{
-public:
-    virtual ~Token() { }
-    virtual bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const = 0;
-};
+// Tokens are plain value types: impl::parse templates know their static type, so every parse()
+// is resolved at compile time and can be inlined. Deriving from Token only marks a class as token.
+struct Token { };
 
 class IntToken : public Token
 {
 public:
-    IntToken(int &target, int digitCount = -1);
-    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const override;
+    IntToken(int& target, int digitCount = -1) :
+        _target(target),
+        _digitCount(digitCount) { }
+
+    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const
+    {
+        int digitCount = 0;
+        int result = 0;
+        for (; begin < end && *begin >= '0' && *begin <= '9'; ++begin)
+        {
+            result = 10*result + (*begin - '0');
+            ++digitCount;
+        }
+        if (digitCount == 0 || (_digitCount >= 0 && _digitCount != digitCount))
+        {
+            return false;
+        }
+        _target = result;
+        return true;
+    }
 private:
     int& _target;
     int _digitCount;
@@ -24,8 +42,24 @@ private:
 class BareStringToken : public Token
 {
 public:
-    BareStringToken(std::string& target);
-    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const override;
+    BareStringToken(std::string& target) :
+        _target(target) { }
+
+    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const
+    {
+        auto start = begin;
+        while (begin < end && isalnum(static_cast<unsigned char>(*begin)))
+        {
+            ++begin;
+        }
+        if (begin == start)
+        {
+            return false;
+        }
+        // reuses capacity of target
+        _target.assign(start, begin);
+        return true;
+    }
 private:
     std::string& _target;
 };
@@ -33,8 +67,52 @@ private:
 class QuotedStringToken : public Token
 {
 public:
-    QuotedStringToken(std::string& target);
-    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const override;
+    QuotedStringToken(std::string& target) :
+        _target(target) { }
+
+    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const
+    {
+        if (begin >= end || *begin != '"')
+        {
+            return false;
+        }
+        // first pass finds closing quote, so that target is written only if string is valid
+        auto pos = begin + 1;
+        size_t length = 0;
+        bool escaped = false;
+        for (; pos < end && (escaped || *pos != '"'); ++pos)
+        {
+            if (escaped || *pos != '\\')
+            {
+                ++length;
+                escaped = false;
+            }
+            else
+            {
+                escaped = true;
+            }
+        }
+        if (pos == end)
+        {
+            return false;
+        }
+        _target.clear();
+        _target.reserve(length);
+        for (auto it = begin + 1; it < pos; ++it)
+        {
+            if (*it == '\\' && ! escaped)
+            {
+                escaped = true;
+            }
+            else
+            {
+                _target += *it;
+                escaped = false;
+            }
+        }
+        begin = pos + 1;
+        return true;
+    }
 private:
     std::string& _target;
 };
@@ -42,8 +120,18 @@ private:
 class TimestampToken : public Token
 {
 public:
-    TimestampToken(Timestamp& target);
-    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const override;
+    TimestampToken(Timestamp& target) :
+        _target(target) { }
+
+    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const
+    {
+        if (end - begin < static_cast<std::ptrdiff_t>(TIMESTAMP_LENGTH) || ! parseTimestamp(&*begin, _target))
+        {
+            return false;
+        }
+        begin += TIMESTAMP_LENGTH;
+        return true;
+    }
 private:
     Timestamp& _target;
 };
@@ -51,8 +139,19 @@ private:
 class SecondsToken : public Token
 {
 public:
-    SecondsToken(Duration& target);
-    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const override;
+    SecondsToken(Duration& target) :
+        _target(target) { }
+
+    bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end) const
+    {
+        int count;
+        if (! IntToken(count).parse(begin, end))
+        {
+            return false;
+        }
+        _target = std::chrono::seconds(count);
+        return true;
+    }
 private:
     Duration& _target;
 };
@@ -67,8 +166,9 @@ template <typename... Args>
 bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end, const char* str, const Args&... args);
 template <typename... Args>
 bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end, const std::string& str, const Args&... args);
-template <typename... Args>
-bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end, const Token& token, const Args&... args);
+template <typename T, typename... Args>
+typename std::enable_if<std::is_base_of<Token, T>::value, bool>::type
+parse(std::string::const_iterator& begin, const std::string::const_iterator& end, const T& token, const Args&... args);
 
 inline bool parse(std::string::const_iterator&, const std::string::const_iterator&)
 {
@@ -116,8 +216,9 @@ bool parse(std::string::const_iterator& begin, const std::string::const_iterator
     }
 }
 
-template <typename... Args>
-bool parse(std::string::const_iterator& begin, const std::string::const_iterator& end, const Token& token, const Args&... args)
+template <typename T, typename... Args>
+typename std::enable_if<std::is_base_of<Token, T>::value, bool>::type
+parse(std::string::const_iterator& begin, const std::string::const_iterator& end, const T& token, const Args&... args)
 {
     if (token.parse(begin, end))
     {
@@ -145,6 +246,29 @@ bool parse(const std::string& str, const Args&... args)
     }
 }
 
+// Building blocks for grammars where alternatives share a prefix: prefix is parsed once
+// with parsePrefix, then alternatives are tried from where it ended.
+
+// parses args from begin, on success moves begin past them, rest of input may remain
+template <typename... Args>
+bool parsePrefix(std::string::const_iterator& begin, const std::string::const_iterator& end, const Args&... args)
+{
+    auto pos = begin;
+    if (! impl::parse(pos, end, args...))
+    {
+        return false;
+    }
+    begin = pos;
+    return true;
+}
+
+// parses args from begin, they have to cover all input up to end
+template <typename... Args>
+bool parseRest(std::string::const_iterator begin, const std::string::const_iterator& end, const Args&... args)
+{
+    return impl::parse(begin, end, args...) && begin == end;
+}
+
 std::string quoteString(const std::string& str);
 
 #endif
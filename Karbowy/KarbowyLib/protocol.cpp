@@ -5,16 +5,16 @@
 #include "protocolerror.h"
 #include "parse.h"
 #include "task.h"
+#include "framing.h"
+#include "crypto.h"
 #include <boost/optional.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/uuid/uuid.hpp>
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/lexical_cast.hpp>
-#include <crypto++/filters.h>
-#include <crypto++/hex.h>
-#include <crypto++/osrng.h>
 
 #include <iostream>
+#include <stdexcept>
 
 enum ChallengeType
 {
@@ -41,24 +41,6 @@ static const char* typeToString(ChallengeType type)
 
 
 
-static std::string generateChallenge()
-{
-    CryptoPP::AutoSeededRandomPool prng;
-    CryptoPP::SecByteBlock seed(16);
-    prng.GenerateBlock(seed, seed.size());
-    std::string challenge;
-    CryptoPP::ArraySource(seed, seed.size(), true, new CryptoPP::HexEncoder(new CryptoPP::StringSink(challenge)));
-    return challenge;
-}
-
-static std::string SHA(const std::string& message)
-{
-    CryptoPP::SHA256 hash;
-    std::string digest;
-    CryptoPP::StringSource s(message, true, new CryptoPP::HashFilter(hash, new CryptoPP::HexEncoder(new CryptoPP::StringSink(digest))));
-    return digest;
-}
-
 static boost::optional<std::string> extractSuffix(const std::string& str, const std::string& prefix)
 {
     if (boost::istarts_with(str, prefix))
@@ -88,7 +70,7 @@ static boost::optional<std::string> extractSuffix(const std::string& str, const
 static std::string sendChallenge(ChallengeType type, TcpStream& conn)
 {
     std::string challenge = generateChallenge();
-    conn.writeLine(concatln(typeToString(type), " CHALLENGE ", challenge));
+    conn.writeLineOf(typeToString(type), " CHALLENGE ", challenge);
     return challenge;
 }
 
@@ -139,7 +121,7 @@ std::string receiveLoginChallenge(TcpStream &conn)
 
 static void sendChallengeResponse(ChallengeType type, TcpStream& conn, const std::string& secret, const std::string& challenge)
 {
-    conn.writeLine(concatln(typeToString(type), " RESPONSE ", SHA(secret + challenge)));
+    conn.writeLineOf(typeToString(type), " RESPONSE ", sha256Hex(secret, challenge));
 }
 
 void sendServerChallengeResponse(TcpStream& conn, const std::string& secret, const std::string& challenge)
@@ -186,12 +168,12 @@ std::string receiveLoginChallengeResponse(TcpStream& conn)
 
 bool verifyChallengeResponse(const std::string& secret, const std::string& challenge, const std::string& response)
 {
-    return SHA(secret + challenge) == response;
+    return sha256Hex(secret, challenge) == response;
 }
 
 static void sendChallengeAck(ChallengeType type, TcpStream& conn, bool ok)
 {
-    conn.writeLine(concatln(typeToString(type), " RESPONSE ", ok ? "OK" : "NOK"));
+    conn.writeLineOf(typeToString(type), " RESPONSE ", ok ? "OK" : "NOK");
 }
 
 void sendServerChallengeAck(TcpStream &conn, bool ok)
@@ -248,7 +230,7 @@ static const char* clientUuidCmdPrefix = "CLIENT UUID ";
 
 void sendClientUuid(TcpStream& conn, const std::string& uuid)
 {
-    conn.writeLine(concatln(clientUuidCmdPrefix, uuid));
+    conn.writeLineOf(clientUuidCmdPrefix, uuid);
 }
 
 std::string receiveClientUuid(TcpStream& conn)
@@ -276,7 +258,7 @@ static const char* loginCmdPrefix = "LOGIN ";
 
 void sendLoginRequest(TcpStream& conn, const std::string& userId)
 {
-    conn.writeLine(concatln(loginCmdPrefix, userId));
+    conn.writeLineOf(loginCmdPrefix, userId);
 }
 
 std::string receiveLoginRequest(TcpStream& conn)
@@ -290,6 +272,164 @@ std::string receiveLoginRequest(TcpStream& conn)
     return *maybeUserId;
 }
 
+static bool parseLogEntry(std::string::const_iterator pos, const std::string::const_iterator& end, LogEntry& entry)
+{
+    // <timestamp> <user> LOGIN | LOGOUT | TASK <id> START | PAUSE | FINISH
+    // common prefix is parsed once, then verb decides the rest
+    if (! parsePrefix(pos, end, TimestampToken(entry._timestamp), ' ', BareStringToken(entry._userId), ' '))
+    {
+        return false;
+    }
+    int taskId;
+    if (parseRest(pos, end, "LOGIN"))
+    {
+        entry._type = LogEntryType_LOGIN;
+        entry._taskId = boost::none;
+    }
+    else if (parseRest(pos, end, "LOGOUT"))
+    {
+        entry._type = LogEntryType_LOGOUT;
+        entry._taskId = boost::none;
+    }
+    else if (parsePrefix(pos, end, "TASK ", IntToken(taskId), ' '))
+    {
+        if (parseRest(pos, end, "START"))
+        {
+            entry._type = LogEntryType_TASK_START;
+        }
+        else if (parseRest(pos, end, "PAUSE"))
+        {
+            entry._type = LogEntryType_TASK_PAUSE;
+        }
+        else if (parseRest(pos, end, "FINISH"))
+        {
+            entry._type = LogEntryType_TASK_FINISH;
+        }
+        else
+        {
+            return false;
+        }
+        entry._taskId = taskId;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool parseLogEntry(const std::string& line, LogEntry& entry)
+{
+    return parseLogEntry(line.cbegin(), line.cend(), entry);
+}
+
+bool parseSequencedLogEntry(const std::string& line, int& sequence, LogEntry& entry)
+{
+    // <sequence> <log entry>
+    auto pos = line.cbegin();
+    return parsePrefix(pos, line.cend(), IntToken(sequence), ' ') && parseLogEntry(pos, line.cend(), entry);
+}
+
+template <typename Records, typename AppendRecord>
+static void appendFrames(std::string& out, const Records& records, AppendRecord appendRecord)
+{
+    static const size_t frameSize = 64 * 1024;
+
+    size_t frameStart = beginFrame(out);
+    for (const auto& record : records)
+    {
+        size_t recordStart = out.size();
+        appendRecord(out, record);
+        // receiver drops connection on frames above MAX_FRAME_SIZE, records can't span frames
+        if (out.size() - recordStart > MAX_FRAME_SIZE)
+        {
+            throw std::length_error("Record too long for binary frame");
+        }
+        if (out.size() - frameStart - FRAME_HEADER_SIZE > MAX_FRAME_SIZE)
+        {
+            std::string last(out, recordStart);
+            out.resize(recordStart);
+            endFrame(out, frameStart);
+            frameStart = beginFrame(out);
+            out += last;
+        }
+        if (out.size() - frameStart >= frameSize)
+        {
+            endFrame(out, frameStart);
+            frameStart = beginFrame(out);
+        }
+    }
+    if (out.size() - frameStart > FRAME_HEADER_SIZE)
+    {
+        endFrame(out, frameStart);
+        appendEmptyFrame(out);
+    }
+    // else last frame is empty and ends the sequence
+}
+
+static void appendTaskRecordOf(std::string& out, const std::unique_ptr<ClientTask>& task)
+{
+    appendTaskRecord(out, *task);
+}
+
+static void appendTasksText(std::string& out, const std::vector<std::unique_ptr<ClientTask> >& tasks)
+{
+    for (const auto& task : tasks)
+    {
+        concatlnTo(out, "TASK ", task->_id, " TITLE ", quoteString(task->_title), " SPENT ", toSeconds(task->_timeSpent));
+        for (const auto& line : task->_description)
+        {
+            concatlnTo(out, line);
+        }
+        out += '\n';
+    }
+}
+
+std::string formatTasksFrames(const std::vector<std::unique_ptr<ClientTask> >& tasks)
+{
+    std::string out;
+    appendFrames(out, tasks, appendTaskRecordOf);
+    return out;
+}
+
+std::string formatTasksText(const std::vector<std::unique_ptr<ClientTask> >& tasks)
+{
+    std::string out;
+    appendTasksText(out, tasks);
+    out += "END TASKS\n";
+    return out;
+}
+
+std::string formatTaskListDelta(const TaskListDelta& delta, bool binaryFraming)
+{
+    std::string out;
+    concatlnTo(out, delta._complete ? "ALL TASKS VERSION " : "CHANGED TASKS VERSION ", delta._version);
+    if (binaryFraming)
+    {
+        appendFrames(out, delta._changed, appendTaskRecordOf);
+        appendFrames(out, delta._removed, appendRemovedTaskRecord);
+    }
+    else
+    {
+        appendTasksText(out, delta._changed);
+        for (int taskId : delta._removed)
+        {
+            concatlnTo(out, "REMOVED TASK ", taskId);
+        }
+        out += "END TASKS\n";
+    }
+    return out;
+}
+
+std::string formatLastSequence(int lastSequence, const boost::optional<Timestamp>& lastEntryTime)
+{
+    if (lastEntryTime)
+    {
+        return concatln("LAST SEQUENCE ", lastSequence, " LAST ENTRY AT ", *lastEntryTime);
+    }
+    return concatln("LAST SEQUENCE ", lastSequence);
+}
+
 //--------------------------------------------------------------------------------------------------------------------------------------------
 
 using namespace std::placeholders;
@@ -303,7 +443,12 @@ AsyncClient::AsyncClient(MainLoop& mainLoop,
     _onErrorHook(onError),
     _defaultOnConnectHook(defaultOnConnect),
     _connected(false),
-    _busy(false) { }
+    _busy(false),
+    _binaryFraming(false),
+    _lastSentSequence(0),
+    _logsExhausted(false),
+    _fillingUploadWindow(false),
+    _chunksInFlight(0) { }
 
 void AsyncClient::connect(const ConnectCallback& onConnect)
 {
@@ -362,6 +507,26 @@ void AsyncClient::retrieveTasks(const RetrieveTasksCallback& onTasksRetrieved)
     }
 }
 
+void AsyncClient::retrieveTaskChanges(int sinceVersion, const RetrieveTaskChangesCallback& onTaskChangesRetrieved)
+{
+    _onTaskChangesRetrievedHook = onTaskChangesRetrieved;
+    if (_connected)
+    {
+        issueRetrieveTaskChangesRequest(sinceVersion);
+    }
+    else
+    {
+        connect([this, sinceVersion]()
+        {
+            if (_defaultOnConnectHook)
+            {
+                _defaultOnConnectHook();
+            }
+            issueRetrieveTaskChangesRequest(sinceVersion);
+        });
+    }
+}
+
 void AsyncClient::sendLogs(const RetrieveLogsCallback& retrieveLogs, const LogsSentCallback& onLogsSent)
 {
     std::cout << __PRETTY_FUNCTION__ << std::endl;
@@ -440,7 +605,7 @@ void AsyncClient::afterReceiveClientChallenge(const std::string& line)
         handleProtocolError("Invalid client challenge", line);
         return;
     }
-    _conn->asyncWrite(concatln("CLIENT RESPONSE ", SHA(_config._serverUuid + *challenge)),
+    _conn->asyncWrite(concatln("CLIENT RESPONSE ", sha256Hex(_config._serverUuid, *challenge)),
                      std::bind(&AsyncClient::afterSendClientChallengeResponse, this));
 }
 
@@ -509,7 +674,7 @@ void AsyncClient::afterReceiveLoginChallenge(const std::string& line)
         handleProtocolError("Invalid login challenge", line);
         return;
     }
-    _conn->asyncWrite(concatln("LOGIN RESPONSE ", SHA(_config._password + *challenge)),
+    _conn->asyncWrite(concatln("LOGIN RESPONSE ", sha256Hex(_config._password, *challenge)),
                      std::bind(&AsyncClient::afterSendLoginChallengeResponse, this));
 }
 
@@ -542,18 +707,51 @@ void AsyncClient::afterReceiveLoginChallengeAck(const std::string& line)
         return;
     }
 
-    if (loginOk)
+    if (! loginOk)
     {
-        _connected = true;
-        _busy = false;
-        if (_onConnect)
-        {
-            _onConnect();
-        }
+        handleError("Login challenge response rejected");
+    }
+    else if (_config._binaryFraming)
+    {
+        _conn->asyncWrite("FRAMING BINARY\n", std::bind(&AsyncClient::afterSendFramingRequest, this));
     }
     else
     {
-        handleError("Login challenge response rejected");
+        _binaryFraming = false;
+        finishConnecting();
+    }
+}
+
+void AsyncClient::afterSendFramingRequest()
+{
+    _conn->asyncReadLine(std::bind(&AsyncClient::afterReceiveFramingResponse, this, _1));
+}
+
+void AsyncClient::afterReceiveFramingResponse(const std::string& line)
+{
+    if (boost::iequals(line, "FRAMING BINARY OK"))
+    {
+        _binaryFraming = true;
+    }
+    else if (boost::iequals(line, "FRAMING TEXT"))
+    {
+        _binaryFraming = false;
+    }
+    else
+    {
+        handleProtocolError("Invalid framing response", line);
+        return;
+    }
+    finishConnecting();
+}
+
+void AsyncClient::finishConnecting()
+{
+    _connected = true;
+    _busy = false;
+    if (_onConnect)
+    {
+        _onConnect();
     }
 }
 
@@ -568,58 +766,192 @@ void AsyncClient::issueRetrieveTasksRequest()
     _conn->asyncWrite("RETRIEVE TASKS\n", std::bind(&AsyncClient::startReceivingTasks, this));
 }
 
+void AsyncClient::issueRetrieveTaskChangesRequest(int sinceVersion)
+{
+    assert(_connected);
+    assert(! _busy);
+
+    _busy = true;
+    _delta = std::make_unique<TaskListDelta>();
+    _conn->asyncWrite(concatln("RETRIEVE TASKS SINCE ", sinceVersion),
+                      std::bind(&AsyncClient::afterSendRetrieveTaskChangesRequest, this));
+}
+
+void AsyncClient::afterSendRetrieveTaskChangesRequest()
+{
+    _conn->asyncReadLine(std::bind(&AsyncClient::receiveTaskChangesHeader, this, _1));
+}
+
+void AsyncClient::receiveTaskChangesHeader(const std::string& line)
+{
+    if (parse(line, "ALL TASKS VERSION ", IntToken(_delta->_version)))
+    {
+        _delta->_complete = true;
+    }
+    else if (parse(line, "CHANGED TASKS VERSION ", IntToken(_delta->_version)))
+    {
+        _delta->_complete = false;
+    }
+    else
+    {
+        handleProtocolError("Invalid task changes header", line);
+        return;
+    }
+    startReceivingTasks();
+}
+
 void AsyncClient::startReceivingTasks()
 {
     std::cout << __PRETTY_FUNCTION__ << std::endl;
 
-    _conn->asyncReadLine(std::bind(&AsyncClient::receiveTaskHeader, this, _1));
+    if (_binaryFraming)
+    {
+        _conn->asyncReadFrame(std::bind(&AsyncClient::receiveTasksFrame, this, _1));
+    }
+    else
+    {
+        _conn->asyncReadLine(std::bind(&AsyncClient::receiveTaskLine, this, _1));
+    }
 }
 
-void AsyncClient::receiveTaskHeader(const std::string& line)
+void AsyncClient::receiveTaskLine(const std::string& line)
 {
     std::cout << __PRETTY_FUNCTION__ << std::endl;
 
-    if (_currentTask)
+    // consume whatever is already buffered in a loop instead of recursing through asyncReadLine
+    bool more = handleTaskLine(line);
+    std::string nextLine;
+    while (more && _conn->readBufferedLine(nextLine))
     {
-        _tasks.emplace_back(std::move(_currentTask));
+        more = handleTaskLine(nextLine);
     }
-    if (boost::iequals(line, "END TASKS"))
+    if (more)
     {
-        _busy = false;
-        if (_onTasksRetrievedHook)
+        _conn->asyncReadLine(std::bind(&AsyncClient::receiveTaskLine, this, _1));
+    }
+}
+
+// task header, description lines and empty line; returns false after END TASKS or error
+bool AsyncClient::handleTaskLine(const std::string& line)
+{
+    if (_currentTask)
+    {
+        if (line.empty())
+        {
+            _tasks.emplace_back(std::move(_currentTask));
+        }
+        else
         {
-            _onTasksRetrievedHook(std::move(_tasks));
+            _currentTask->_description.push_back(line);
         }
+        return true;
+    }
+
+    int removedTaskId;
+    if (boost::iequals(line, "END TASKS"))
+    {
+        finishReceivingTasks();
+        return false;
+    }
+    else if (_delta && parse(line, "REMOVED TASK ", IntToken(removedTaskId)))
+    {
+        _delta->_removed.push_back(removedTaskId);
+        return true;
     }
     else
     {
-        _currentTask = std::make_unique<ClientTask>();
+        auto task = std::make_unique<ClientTask>();
         if (parse(line,
-                  "TASK ", IntToken(_currentTask->_id),
-                  " TITLE ", QuotedStringToken(_currentTask->_title),
-                  " SPENT ", SecondsToken(_currentTask->_timeSpent)))
+                  "TASK ", IntToken(task->_id),
+                  " TITLE ", QuotedStringToken(task->_title),
+                  " SPENT ", SecondsToken(task->_timeSpent)))
         {
-            _conn->asyncReadLine(std::bind(&AsyncClient::receiveTaskDescription, this, _1));
+            _currentTask = std::move(task);
+            return true;
         }
         else
         {
             handleProtocolError("Invalid task header", line);
+            return false;
         }
     }
 }
 
-void AsyncClient::receiveTaskDescription(const std::string& line)
+void AsyncClient::receiveTasksFrame(boost::string_view payload)
 {
     std::cout << __PRETTY_FUNCTION__ << std::endl;
 
-    if (line.empty())
+    do
+    {
+        if (payload.empty())
+        {
+            if (_delta)
+            {
+                _conn->asyncReadFrame(std::bind(&AsyncClient::receiveRemovedTasksFrame, this, _1));
+            }
+            else
+            {
+                finishReceivingTasks();
+            }
+            return;
+        }
+        while (! payload.empty())
+        {
+            auto task = std::make_unique<ClientTask>();
+            if (! parseTaskRecord(payload, *task))
+            {
+                handleError("Protocol error: Invalid task record");
+                return;
+            }
+            _tasks.emplace_back(std::move(task));
+        }
+    }
+    while (_conn->readBufferedFrame(payload));
+    _conn->asyncReadFrame(std::bind(&AsyncClient::receiveTasksFrame, this, _1));
+}
+
+void AsyncClient::receiveRemovedTasksFrame(boost::string_view payload)
+{
+    do
     {
-        _conn->asyncReadLine(std::bind(&AsyncClient::receiveTaskHeader, this, _1));
+        if (payload.empty())
+        {
+            finishReceivingTasks();
+            return;
+        }
+        while (! payload.empty())
+        {
+            int taskId;
+            if (! parseRemovedTaskRecord(payload, taskId))
+            {
+                handleError("Protocol error: Invalid removed task record");
+                return;
+            }
+            _delta->_removed.push_back(taskId);
+        }
     }
-    else
+    while (_conn->readBufferedFrame(payload));
+    _conn->asyncReadFrame(std::bind(&AsyncClient::receiveRemovedTasksFrame, this, _1));
+}
+
+void AsyncClient::finishReceivingTasks()
+{
+    _busy = false;
+    // hooks take rvalue references and may leave argument intact, next request must start from empty list
+    TasksList tasks = std::move(_tasks);
+    _tasks.clear();
+    if (_delta)
+    {
+        std::unique_ptr<TaskListDelta> delta = std::move(_delta);
+        delta->_changed = std::move(tasks);
+        if (_onTaskChangesRetrievedHook)
+        {
+            _onTaskChangesRetrievedHook(std::move(*delta));
+        }
+    }
+    else if (_onTasksRetrievedHook)
     {
-        _currentTask->_description.push_back(line);
-        _conn->asyncReadLine(std::bind(&AsyncClient::receiveTaskDescription, this, _1));
+        _onTasksRetrievedHook(std::move(tasks));
     }
 }
 
@@ -648,95 +980,814 @@ void AsyncClient::startSendingLogs(const std::string& line)
     Timestamp lastTimestamp;
     if (parse(line, "LAST ENTRY AT ", TimestampToken(lastTimestamp)))
     {
-        _entrys = _retrieveLogs(lastTimestamp);
+        _nextLogEntry = _retrieveLogs(lastTimestamp);
     }
     else if (boost::iequals(line, "NO ENTRYS"))
     {
-        _entrys = _retrieveLogs(boost::none);
+        _nextLogEntry = _retrieveLogs(boost::none);
     }
     else
     {
         handleProtocolError("Invalid last entry line", line);
         return;
     }
-    sendLogEntry();
+    startUpload();
 }
 
-void AsyncClient::sendLogEntry()
+void AsyncClient::sendLogsResumable(const RetrieveSequencedLogsCallback& retrieveLogs,
+                                    const LogsAcknowledgedCallback& onLogsAcknowledged,
+                                    const LogsSentCallback& onLogsSent)
 {
-    std::cout << __PRETTY_FUNCTION__ << std::endl;
-
-    if (_entrys.empty())
+    _retrieveSequencedLogs = retrieveLogs;
+    _onLogsAcknowledgedHook = onLogsAcknowledged;
+    _onLogsSentHook = onLogsSent;
+    if (_connected)
     {
-        _conn->asyncWrite("END LOG\n", std::bind(&AsyncClient::finishSendingLogs, this));
+        issueSendLogsResumableRequest();
     }
     else
     {
-        const LogEntry &entry = _entrys.front();
-        std::string line = concat(formatTimestamp(entry._timestamp), ' ', entry._userId);
-        switch (entry._type)
+        connect([this]()
         {
-        case LogEntryType_LOGIN:
-            line = concatln(line, " LOGIN");
-            break;
-        case LogEntryType_LOGOUT:
-            line = concatln(line, " LOGOUT");
-            break;
-        case LogEntryType_TASK_START:
-            line = concatln(line, " TASK ", *entry._taskId, " START");
-            break;
-        case LogEntryType_TASK_PAUSE:
-            line = concatln(line, " TASK ", *entry._taskId, " PAUSE");
-            break;
-        case LogEntryType_TASK_FINISH:
-            line = concatln(line, " TASK ", *entry._taskId, " FINISH");
-            break;
-        default:
-            assert(false);
-        }
-        _conn->asyncWrite(line, std::bind(&AsyncClient::sendNextLogEntry, this));
+            if (_defaultOnConnectHook)
+            {
+                _defaultOnConnectHook();
+            }
+            issueSendLogsResumableRequest();
+        });
     }
 }
 
-void AsyncClient::sendNextLogEntry()
+void AsyncClient::issueSendLogsResumableRequest()
 {
-    std::cout << __PRETTY_FUNCTION__ << std::endl;
+    assert(_connected);
+    assert(! _busy);
 
-    assert(! _entrys.empty());
-    _entrys.pop_front();
-    sendLogEntry();
+    _busy = true;
+    _conn->asyncWrite("LOG UPLOAD RESUMABLE\n", std::bind(&AsyncClient::readLastSequence, this));
 }
 
-void AsyncClient::finishSendingLogs()
+void AsyncClient::readLastSequence()
 {
-    std::cout << __PRETTY_FUNCTION__ << std::endl;
+    _conn->asyncReadLine(std::bind(&AsyncClient::startSendingLogsResumable, this, _1));
+}
 
-    _busy = false;
-    if (_onLogsSentHook)
+void AsyncClient::startSendingLogsResumable(const std::string& line)
+{
+    int lastSequence;
+    Timestamp lastTimestamp;
+    boost::optional<Timestamp> lastEntryTime;
+    if (parse(line, "LAST SEQUENCE ", IntToken(lastSequence), " LAST ENTRY AT ", TimestampToken(lastTimestamp)))
     {
-        _onLogsSentHook();
+        lastEntryTime = lastTimestamp;
+    }
+    else if (! parse(line, "LAST SEQUENCE ", IntToken(lastSequence)))
+    {
+        handleProtocolError("Invalid last sequence line", line);
+        return;
     }
+    _nextSequencedLogEntry = _retrieveSequencedLogs(lastSequence, lastEntryTime);
+    _lastSentSequence = lastSequence;
+    // acknowledgements come while entries are still being sent
+    _conn->asyncReadLine(std::bind(&AsyncClient::receiveLogAck, this, _1));
+    startUpload();
 }
 
-
-void AsyncClient::handleProtocolError(const std::string& errorMsg, const std::string& line)
+void AsyncClient::startUpload()
 {
-    std::cout << __PRETTY_FUNCTION__ << std::endl;
-
-    handleError(concat("Protocol error: ", errorMsg, ": '", line, '\''));
+    _chunksInFlight = 0;
+    _logsExhausted = false;
+    _fillingUploadWindow = false;
+    sendLogEntries();
 }
 
-void AsyncClient::handleError(const std::string& errorMsg)
+static void appendLogEntry(std::string& out, const LogEntry& entry)
 {
-    std::cout << __PRETTY_FUNCTION__ << std::endl;
+    concatTo(out, entry._timestamp, ' ', entry._userId);
+    switch (entry._type)
+    {
+    case LogEntryType_LOGIN:
+        out += " LOGIN\n";
+        break;
+    case LogEntryType_LOGOUT:
+        out += " LOGOUT\n";
+        break;
+    case LogEntryType_TASK_START:
+        concatlnTo(out, " TASK ", *entry._taskId, " START");
+        break;
+    case LogEntryType_TASK_PAUSE:
+        concatlnTo(out, " TASK ", *entry._taskId, " PAUSE");
+        break;
+    case LogEntryType_TASK_FINISH:
+        concatlnTo(out, " TASK ", *entry._taskId, " FINISH");
+        break;
+    default:
+        assert(false);
+    }
+}
 
-    _connected = false;
-    _busy = false;
-    if (_conn)
+// appends next entry from current cursor to chunk, returns false if there are no more entries
+bool AsyncClient::nextLogEntry(std::string& chunk)
+{
+    LogEntry entry;
+    if (_nextSequencedLogEntry)
     {
-        _conn->detach();
-        _conn.reset();
+        int sequence;
+        if (! _nextSequencedLogEntry(sequence, entry))
+        {
+            return false;
+        }
+        assert(sequence > _lastSentSequence);
+        _lastSentSequence = sequence;
+        if (_binaryFraming)
+        {
+            appendSequencedLogEntryRecord(chunk, sequence, entry);
+        }
+        else
+        {
+            concatTo(chunk, sequence, ' ');
+            appendLogEntry(chunk, entry);
+        }
+    }
+    else
+    {
+        if (! _nextLogEntry(entry))
+        {
+            return false;
+        }
+        if (_binaryFraming)
+        {
+            appendLogEntryRecord(chunk, entry);
+        }
+        else
+        {
+            appendLogEntry(chunk, entry);
+        }
+    }
+    return true;
+}
+
+void AsyncClient::sendLogEntries()
+{
+    std::cout << __PRETTY_FUNCTION__ << std::endl;
+
+    // entries are pulled from cursor and serialized into big chunks, at most UPLOAD_WINDOW of them wait
+    // in socket's queue; next chunk is formatted when one of them was sent, so memory usage doesn't
+    // depend on backlog size
+    _fillingUploadWindow = true;
+    while (_chunksInFlight < UPLOAD_WINDOW)
+    {
+        std::string chunk;
+        chunk.reserve(UPLOAD_CHUNK_SIZE + 512);
+        // in binary mode every chunk is a single frame
+        size_t frameStart = _binaryFraming ? beginFrame(chunk) : 0;
+        while (chunk.size() < UPLOAD_CHUNK_SIZE && ! _logsExhausted)
+        {
+            _logsExhausted = ! nextLogEntry(chunk);
+        }
+        if (_binaryFraming)
+        {
+            endFrame(chunk, frameStart);
+        }
+        if (_logsExhausted)
+        {
+            _fillingUploadWindow = false;
+            bool resumable = static_cast<bool>(_nextSequencedLogEntry);
+            _nextLogEntry = LogCursor();
+            _nextSequencedLogEntry = SequencedLogCursor();
+            if (! _binaryFraming)
+            {
+                chunk += "END LOG\n";
+            }
+            else if (chunk.size() > FRAME_HEADER_SIZE)
+            {
+                // otherwise the frame itself is empty and ends the upload
+                appendEmptyFrame(chunk);
+            }
+            // resumable upload is finished by server's LOG COMMITTED line, see receiveLogAck
+            _conn->asyncWrite(std::move(chunk), resumable ? AsyncSocket::WriteHandler() :
+                                                            AsyncSocket::WriteHandler(std::bind(&AsyncClient::finishSendingLogs, this)));
+            return;
+        }
+        ++_chunksInFlight;
+        _conn->asyncWrite(std::move(chunk), std::bind(&AsyncClient::afterSendLogChunk, this));
+        if (! _conn)
+        {
+            // write failed and connection was closed
+            return;
+        }
+    }
+    _fillingUploadWindow = false;
+}
+
+void AsyncClient::afterSendLogChunk()
+{
+    --_chunksInFlight;
+    // chunk may be written at once, from inside asyncWrite called by sendLogEntries - its loop
+    // continues then instead of recursing; when there are no entries left, END LOG is already queued
+    if (! _fillingUploadWindow && ! _logsExhausted)
+    {
+        sendLogEntries();
+    }
+}
+
+void AsyncClient::receiveLogAck(const std::string& line)
+{
+    bool more = handleLogAck(line);
+    std::string nextLine;
+    while (more && _conn->readBufferedLine(nextLine))
+    {
+        more = handleLogAck(nextLine);
+    }
+    if (more)
+    {
+        _conn->asyncReadLine(std::bind(&AsyncClient::receiveLogAck, this, _1));
+    }
+}
+
+bool AsyncClient::handleLogAck(const std::string& line)
+{
+    int sequence;
+    if (parse(line, "ACK ", IntToken(sequence)))
+    {
+        if (_onLogsAcknowledgedHook)
+        {
+            _onLogsAcknowledgedHook(sequence);
+        }
+        return true;
+    }
+    else if (parse(line, "LOG COMMITTED ", IntToken(sequence)))
+    {
+        if (! _logsExhausted || sequence < _lastSentSequence)
+        {
+            handleProtocolError("Not all log entries were committed", line);
+            return false;
+        }
+        if (_onLogsAcknowledgedHook)
+        {
+            _onLogsAcknowledgedHook(sequence);
+        }
+        finishSendingLogs();
+        return false;
+    }
+    else
+    {
+        handleProtocolError("Invalid log acknowledgement", line);
+        return false;
+    }
+}
+
+void AsyncClient::finishSendingLogs()
+{
+    std::cout << __PRETTY_FUNCTION__ << std::endl;
+
+    _busy = false;
+    if (_onLogsSentHook)
+    {
+        _onLogsSentHook();
+    }
+}
+
+
+void AsyncClient::handleProtocolError(const std::string& errorMsg, const std::string& line)
+{
+    std::cout << __PRETTY_FUNCTION__ << std::endl;
+
+    handleError(concat("Protocol error: ", errorMsg, ": '", line, '\''));
+}
+
+void AsyncClient::handleError(const std::string& errorMsg)
+{
+    std::cout << __PRETTY_FUNCTION__ << std::endl;
+
+    _connected = false;
+    _busy = false;
+    if (_conn)
+    {
+        _conn->detach();
+        _conn.reset();
+    }
+    // drop partially received task list and cursor of interrupted upload
+    _currentTask.reset();
+    _tasks.clear();
+    _delta.reset();
+    _nextLogEntry = LogCursor();
+    _nextSequencedLogEntry = SequencedLogCursor();
+    if (_onErrorHook)
+    {
+        _onErrorHook(errorMsg);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------------------------------------------------
+
+AsyncServerConnection::AsyncServerConnection(MainLoop& mainLoop,
+                                             Descriptor&& fd,
+                                             const std::string& serverUuid,
+                                             bool allowBinaryFraming,
+                                             const ServerCallbacks& callbacks,
+                                             const ErrorCallback& onError) :
+    _mainLoop(mainLoop),
+    _serverUuid(serverUuid),
+    _callbacks(callbacks),
+    _onErrorHook(onError),
+    _conn(std::move(fd), std::bind(&AsyncServerConnection::handleError, this, _1)),
+    _running(false),
+    _allowBinaryFraming(allowBinaryFraming),
+    _binaryFraming(false),
+    _resumableUpload(false),
+    _lastReceivedSequence(0),
+    _acknowledgedSequence(0) { }
+
+AsyncServerConnection::~AsyncServerConnection()
+{
+    stop();
+}
+
+void AsyncServerConnection::start()
+{
+    assert(! _running);
+
+    _running = true;
+    _mainLoop.addObject(_conn);
+    _conn.asyncReadLine(std::bind(&AsyncServerConnection::afterReceiveServerChallenge, this, _1));
+}
+
+void AsyncServerConnection::stop()
+{
+    _running = false;
+    _conn.detach();
+}
+
+void AsyncServerConnection::afterReceiveServerChallenge(const std::string& line)
+{
+    auto challenge = extractSuffix(line, "SERVER CHALLENGE ");
+    if (! challenge)
+    {
+        handleProtocolError("Invalid server challenge", line);
+        return;
+    }
+    _conn.asyncWrite(concatln("SERVER RESPONSE ", sha256Hex(_serverUuid, *challenge)),
+                     std::bind(&AsyncServerConnection::afterSendServerChallengeResponse, this));
+}
+
+void AsyncServerConnection::afterSendServerChallengeResponse()
+{
+    _conn.asyncReadLine(std::bind(&AsyncServerConnection::afterReceiveServerChallengeAck, this, _1));
+}
+
+void AsyncServerConnection::afterReceiveServerChallengeAck(const std::string& line)
+{
+    static const char* okLine = "SERVER RESPONSE OK";
+    static const char* nokLine = "SERVER RESPONSE NOK";
+
+    if (boost::iequals(line, nokLine))
+    {
+        handleError("Server challenge response rejected");
+    }
+    else if (! boost::iequals(line, okLine))
+    {
+        handleProtocolError("Invalid server challenge ack", line);
+    }
+    else
+    {
+        _clientChallenge = generateChallenge();
+        _conn.asyncWrite(concatln("CLIENT CHALLENGE ", _clientChallenge),
+                         std::bind(&AsyncServerConnection::afterSendClientChallenge, this));
+    }
+}
+
+void AsyncServerConnection::afterSendClientChallenge()
+{
+    _conn.asyncReadLine(std::bind(&AsyncServerConnection::afterReceiveClientChallengeResponse, this, _1));
+}
+
+void AsyncServerConnection::afterReceiveClientChallengeResponse(const std::string& line)
+{
+    auto response = extractSuffix(line, "CLIENT RESPONSE ");
+    if (! response)
+    {
+        handleProtocolError("Invalid client challenge response", line);
+        return;
+    }
+    bool clientOk = verifyChallengeResponse(_serverUuid, _clientChallenge, *response);
+    _conn.asyncWrite(concatln("CLIENT RESPONSE ", clientOk ? "OK" : "NOK"),
+                     clientOk ? AsyncSocket::WriteHandler(std::bind(&AsyncServerConnection::afterSendClientChallengeAck, this)) :
+                                AsyncSocket::WriteHandler(std::bind(&AsyncServerConnection::handleError, this, "Client challenge response rejected")));
+}
+
+void AsyncServerConnection::afterSendClientChallengeAck()
+{
+    _conn.asyncReadLine(std::bind(&AsyncServerConnection::afterReceiveClientUuid, this, _1));
+}
+
+void AsyncServerConnection::afterReceiveClientUuid(const std::string& line)
+{
+    auto uuid = extractSuffix(line, clientUuidCmdPrefix);
+    if (! uuid)
+    {
+        handleProtocolError("Invalid client uuid cmd", line);
+        return;
+    }
+    try
+    {
+        boost::lexical_cast<boost::uuids::uuid>(*uuid);
+    }
+    catch (boost::bad_lexical_cast&)
+    {
+        handleProtocolError("Invalid client uuid", *uuid);
+        return;
+    }
+    _clientUuid = *uuid;
+    _conn.asyncReadLine(std::bind(&AsyncServerConnection::afterReceiveLoginRequest, this, _1));
+}
+
+void AsyncServerConnection::afterReceiveLoginRequest(const std::string& line)
+{
+    auto userId = extractSuffix(line, loginCmdPrefix);
+    if (! userId)
+    {
+        handleProtocolError("Invalid login request", line);
+        return;
+    }
+    boost::optional<std::string> password;
+    try
+    {
+        password = _callbacks._findPassword(*userId);
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+        return;
+    }
+    if (! password)
+    {
+        handleError(concat("Employee '", *userId, "' can't log in"));
+        return;
+    }
+    _userId = *userId;
+    _password = *password;
+    _loginChallenge = generateChallenge();
+    _conn.asyncWrite(concatln("LOGIN CHALLENGE ", _loginChallenge),
+                     std::bind(&AsyncServerConnection::afterSendLoginChallenge, this));
+}
+
+void AsyncServerConnection::afterSendLoginChallenge()
+{
+    _conn.asyncReadLine(std::bind(&AsyncServerConnection::afterReceiveLoginChallengeResponse, this, _1));
+}
+
+void AsyncServerConnection::afterReceiveLoginChallengeResponse(const std::string& line)
+{
+    auto response = extractSuffix(line, "LOGIN RESPONSE ");
+    if (! response)
+    {
+        handleProtocolError("Invalid login challenge response", line);
+        return;
+    }
+    bool loginOk = verifyChallengeResponse(_password, _loginChallenge, *response);
+    _conn.asyncWrite(concatln("LOGIN RESPONSE ", loginOk ? "OK" : "NOK"),
+                     loginOk ? AsyncSocket::WriteHandler(std::bind(&AsyncServerConnection::afterSendLoginChallengeAck, this)) :
+                               AsyncSocket::WriteHandler(std::bind(&AsyncServerConnection::handleError, this, "Login challenge response rejected")));
+}
+
+void AsyncServerConnection::afterSendLoginChallengeAck()
+{
+    try
+    {
+        _callbacks._onLogin(_clientUuid, _userId, std::bind(&AsyncServerConnection::afterLogin, this, _1));
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+    }
+}
+
+void AsyncServerConnection::afterLogin(const std::string& errorMsg)
+{
+    if (! _running)
+    {
+        return;
+    }
+    if (! errorMsg.empty())
+    {
+        handleError(errorMsg);
+        return;
+    }
+    awaitCommand();
+}
+
+void AsyncServerConnection::awaitCommand()
+{
+    _conn.asyncReadLine(std::bind(&AsyncServerConnection::handleCommand, this, _1));
+}
+
+void AsyncServerConnection::handleCommand(const std::string& line)
+{
+    int sinceVersion;
+    if (boost::iequals(line, "RETRIEVE TASKS"))
+    {
+        sendTasks();
+    }
+    else if (parse(line, "RETRIEVE TASKS SINCE ", IntToken(sinceVersion)))
+    {
+        sendTaskChanges(sinceVersion);
+    }
+    else if (boost::iequals(line, "LOG UPLOAD"))
+    {
+        startReceivingLogs();
+    }
+    else if (boost::iequals(line, "LOG UPLOAD RESUMABLE"))
+    {
+        startReceivingLogsResumable();
+    }
+    else if (boost::iequals(line, "FRAMING BINARY"))
+    {
+        _binaryFraming = _allowBinaryFraming;
+        _conn.asyncWrite(_binaryFraming ? "FRAMING BINARY OK\n" : "FRAMING TEXT\n",
+                         std::bind(&AsyncServerConnection::awaitCommand, this));
+    }
+    else
+    {
+        handleProtocolError("Invalid command", line);
+    }
+}
+
+void AsyncServerConnection::sendTasks()
+{
+    std::string response;
+    try
+    {
+        response = _callbacks._retrieveTasks(_binaryFraming);
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+        return;
+    }
+    _conn.asyncWrite(std::move(response), std::bind(&AsyncServerConnection::awaitCommand, this));
+}
+
+void AsyncServerConnection::sendTaskChanges(int sinceVersion)
+{
+    std::string response;
+    try
+    {
+        TaskListDelta delta = _callbacks._retrieveTaskChanges(sinceVersion);
+        response = formatTaskListDelta(delta, _binaryFraming);
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+        return;
+    }
+    _conn.asyncWrite(std::move(response), std::bind(&AsyncServerConnection::awaitCommand, this));
+}
+
+void AsyncServerConnection::startReceivingLogs()
+{
+    boost::optional<Timestamp> lastEntryTime;
+    try
+    {
+        lastEntryTime = _callbacks._lastLogEntryTime();
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+        return;
+    }
+    _conn.asyncWrite(lastEntryTime ? concatln("LAST ENTRY AT ", *lastEntryTime) : std::string("NO ENTRYS\n"));
+    _resumableUpload = false;
+    readLogs();
+}
+
+void AsyncServerConnection::startReceivingLogsResumable()
+{
+    int lastSequence;
+    boost::optional<Timestamp> lastEntryTime;
+    try
+    {
+        lastSequence = _callbacks._lastSequence(lastEntryTime);
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+        return;
+    }
+    _conn.asyncWrite(formatLastSequence(lastSequence, lastEntryTime));
+    _resumableUpload = true;
+    _lastReceivedSequence = lastSequence;
+    _acknowledgedSequence = lastSequence;
+    readLogs();
+}
+
+void AsyncServerConnection::readLogs()
+{
+    if (_binaryFraming)
+    {
+        _conn.asyncReadFrame(std::bind(&AsyncServerConnection::receiveLogFrame, this, _1));
+    }
+    else
+    {
+        _conn.asyncReadLine(std::bind(&AsyncServerConnection::receiveLogEntry, this, _1));
+    }
+}
+
+void AsyncServerConnection::receiveLogEntry(const std::string& line)
+{
+    // consume whatever is already buffered in a loop instead of recursing through asyncReadLine
+    bool more = handleLogEntry(line);
+    std::string nextLine;
+    while (more && _conn.readBufferedLine(nextLine))
+    {
+        more = handleLogEntry(nextLine);
+    }
+    if (more)
+    {
+        acknowledgeLogs();
+        _conn.asyncReadLine(std::bind(&AsyncServerConnection::receiveLogEntry, this, _1));
+    }
+}
+
+bool AsyncServerConnection::handleLogEntry(const std::string& line)
+{
+    if (boost::iequals(line, "END LOG"))
+    {
+        finishReceivingLogs();
+        return false;
+    }
+
+    LogEntry entry;
+    if (_resumableUpload)
+    {
+        int sequence;
+        if (! parseSequencedLogEntry(line, sequence, entry))
+        {
+            handleProtocolError("Invalid log entry", line);
+            return false;
+        }
+        return handleSequencedLogEntry(sequence, std::move(entry));
+    }
+    if (! parseLogEntry(line, entry))
+    {
+        handleProtocolError("Invalid log entry", line);
+        return false;
+    }
+    try
+    {
+        _callbacks._onLogEntry(std::move(entry));
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+        return false;
+    }
+    return true;
+}
+
+void AsyncServerConnection::receiveLogFrame(boost::string_view payload)
+{
+    bool more = handleLogFrame(payload);
+    while (more && _conn.readBufferedFrame(payload))
+    {
+        more = handleLogFrame(payload);
+    }
+    if (more)
+    {
+        acknowledgeLogs();
+        _conn.asyncReadFrame(std::bind(&AsyncServerConnection::receiveLogFrame, this, _1));
+    }
+}
+
+bool AsyncServerConnection::handleLogFrame(boost::string_view payload)
+{
+    if (payload.empty())
+    {
+        finishReceivingLogs();
+        return false;
+    }
+    while (! payload.empty())
+    {
+        LogEntry entry;
+        if (_resumableUpload)
+        {
+            int sequence;
+            if (! parseSequencedLogEntryRecord(payload, sequence, entry))
+            {
+                handleError("Protocol error: Invalid log entry record");
+                return false;
+            }
+            if (! handleSequencedLogEntry(sequence, std::move(entry)))
+            {
+                return false;
+            }
+            continue;
+        }
+        if (! parseLogEntryRecord(payload, entry))
+        {
+            handleError("Protocol error: Invalid log entry record");
+            return false;
+        }
+        try
+        {
+            _callbacks._onLogEntry(std::move(entry));
+        }
+        catch (std::exception& ex)
+        {
+            handleError(ex.what());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AsyncServerConnection::handleSequencedLogEntry(int sequence, LogEntry&& entry)
+{
+    if (sequence <= _lastReceivedSequence)
+    {
+        handleError(concat("Protocol error: Log entry sequence number ", sequence, " not greater than ", _lastReceivedSequence));
+        return false;
+    }
+    _lastReceivedSequence = sequence;
+    try
+    {
+        _callbacks._onSequencedLogEntry(sequence, std::move(entry));
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+        return false;
+    }
+    return true;
+}
+
+// sends ACK when entries were committed since last one, called whenever buffered input is consumed
+void AsyncServerConnection::acknowledgeLogs()
+{
+    if (! _resumableUpload)
+    {
+        return;
+    }
+    int committedSequence;
+    try
+    {
+        committedSequence = _callbacks._committedSequence();
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+        return;
+    }
+    if (committedSequence > _acknowledgedSequence)
+    {
+        _acknowledgedSequence = committedSequence;
+        _conn.asyncWrite(concatln("ACK ", committedSequence));
+    }
+}
+
+void AsyncServerConnection::finishReceivingLogs()
+{
+    try
+    {
+        _callbacks._onLogsReceived(std::bind(&AsyncServerConnection::afterLogsStored, this, _1));
+    }
+    catch (std::exception& ex)
+    {
+        handleError(ex.what());
+    }
+}
+
+void AsyncServerConnection::afterLogsStored(const std::string& errorMsg)
+{
+    if (! _running)
+    {
+        return;
+    }
+    if (! errorMsg.empty())
+    {
+        handleError(errorMsg);
+        return;
+    }
+    if (_resumableUpload)
+    {
+        _resumableUpload = false;
+        _conn.asyncWrite(concatln("LOG COMMITTED ", _lastReceivedSequence));
+    }
+    awaitCommand();
+}
+
+void AsyncServerConnection::handleProtocolError(const std::string& errorMsg, const std::string& line)
+{
+    handleError(concat("Protocol error: ", errorMsg, ": '", line, '\''));
+}
+
+void AsyncServerConnection::handleError(const std::string& errorMsg)
+{
+    if (! _running)
+    {
+        return;
     }
+    stop();
     if (_onErrorHook)
     {
         _onErrorHook(errorMsg);
@@ -41,6 +41,24 @@ std::string receiveClientUuid(TcpStream& conn);
 void sendLoginRequest(TcpStream& conn, const std::string& userId);
 std::string receiveLoginRequest(TcpStream& conn);
 
+// parses single line of LOG UPLOAD (without trailing newline)
+bool parseLogEntry(const std::string& line, LogEntry& entry);
+// parses single line of LOG UPLOAD RESUMABLE: sequence number and log entry
+bool parseSequencedLogEntry(const std::string& line, int& sequence, LogEntry& entry);
+
+class ClientTask;
+class TaskListDelta;
+// task list as binary frames ended with empty frame, response to RETRIEVE TASKS in binary framing
+std::string formatTasksFrames(const std::vector<std::unique_ptr<ClientTask> >& tasks);
+// task list as lines ended with END TASKS, response to RETRIEVE TASKS in text framing
+std::string formatTasksText(const std::vector<std::unique_ptr<ClientTask> >& tasks);
+// response to RETRIEVE TASKS SINCE: ALL TASKS VERSION <v> or CHANGED TASKS VERSION <v> line,
+// then changed tasks and ids of removed tasks (REMOVED TASK <id> lines or second sequence of frames)
+std::string formatTaskListDelta(const TaskListDelta& delta, bool binaryFraming);
+// response to LOG UPLOAD RESUMABLE: LAST SEQUENCE <n>, followed by LAST ENTRY AT <time>
+// when time of last entry stored by plain LOG UPLOAD is given
+std::string formatLastSequence(int lastSequence, const boost::optional<Timestamp>& lastEntryTime);
+
 struct ClientConfig
 {
     std::string _myUuid;
@@ -50,10 +68,10 @@ struct ClientConfig
     std::string _userId;
     std::string _password;
     bool _useIpv6;
+    // ask server for binary framing of task lists and log uploads (see framing.h)
+    bool _binaryFraming;
 };
 
-class ClientTask;
-
 class AsyncClient
 {
 public:
@@ -61,8 +79,19 @@ public:
     typedef std::function<void()> ConnectCallback;
     typedef std::vector<std::unique_ptr<ClientTask> > TasksList;
     typedef std::function<void(TasksList&&)> RetrieveTasksCallback;
-    typedef std::deque<LogEntry> LogEntryList;
-    typedef std::function<LogEntryList(const boost::optional<Timestamp>&)> RetrieveLogsCallback;
+    typedef std::function<void(TaskListDelta&&)> RetrieveTaskChangesCallback;
+    // pull-based source of log entries: fills next entry and returns true, returns false when there are no more
+    typedef std::function<bool(LogEntry&)> LogCursor;
+    // returns cursor over entries newer than given timestamp (all entries if none)
+    typedef std::function<LogCursor(const boost::optional<Timestamp>&)> RetrieveLogsCallback;
+    // like LogCursor, but also fills sequence number of entry, numbers have to increase
+    typedef std::function<bool(int&, LogEntry&)> SequencedLogCursor;
+    // returns cursor over entries with sequence numbers greater than given one; before first
+    // resumable upload server may also send time of last entry it got by LOG UPLOAD,
+    // entries up to that time are already stored and have to be skipped
+    typedef std::function<SequencedLogCursor(int, const boost::optional<Timestamp>&)> RetrieveSequencedLogsCallback;
+    // called with sequence number of last entry stored by server
+    typedef std::function<void(int)> LogsAcknowledgedCallback;
     typedef std::function<void()> LogsSentCallback;
 
     AsyncClient(MainLoop &mainLoop,
@@ -72,7 +101,15 @@ public:
 
     void connect(const ConnectCallback& onConnect);
     void retrieveTasks(const RetrieveTasksCallback& onTasksRetrieved);
+    // retrieves only changes since given version returned by previous call, 0 retrieves all tasks
+    void retrieveTaskChanges(int sinceVersion, const RetrieveTaskChangesCallback& onTaskChangesRetrieved);
     void sendLogs(const RetrieveLogsCallback &receiveLogs, const LogsSentCallback& onLogsSent);
+    // LOG UPLOAD RESUMABLE: server acknowledges stored entries while upload goes on and
+    // onLogsSent is called when all of them are stored; if connection breaks, next call
+    // sends only entries server hasn't stored yet
+    void sendLogsResumable(const RetrieveSequencedLogsCallback& retrieveLogs,
+                           const LogsAcknowledgedCallback& onLogsAcknowledged,
+                           const LogsSentCallback& onLogsSent);
     void disconnect();
 
     bool busy() const { return _busy; }
@@ -84,17 +121,33 @@ private:
     std::unique_ptr<AsyncSocket> _conn;
     bool _connected;
     bool _busy;
+    // server agreed on binary framing
+    bool _binaryFraming;
 
     std::function<void()> _onConnect;
     std::string _serverChallenge;
 
     RetrieveTasksCallback _onTasksRetrievedHook;
+    RetrieveTaskChangesCallback _onTaskChangesRetrievedHook;
     std::unique_ptr<ClientTask> _currentTask;
     TasksList _tasks;
+    // set while RETRIEVE TASKS SINCE is in progress, _tasks end up in _delta->_changed
+    std::unique_ptr<TaskListDelta> _delta;
 
     RetrieveLogsCallback _retrieveLogs;
+    RetrieveSequencedLogsCallback _retrieveSequencedLogs;
+    LogsAcknowledgedCallback _onLogsAcknowledgedHook;
     LogsSentCallback _onLogsSentHook;
-    LogEntryList _entrys;
+    // exactly one of cursors is set while upload is in progress
+    LogCursor _nextLogEntry;
+    SequencedLogCursor _nextSequencedLogEntry;
+    int _lastSentSequence;
+    bool _logsExhausted;
+    bool _fillingUploadWindow;
+    // log upload is streamed in chunks of about UPLOAD_CHUNK_SIZE bytes
+    static const size_t UPLOAD_CHUNK_SIZE = 64 * 1024;
+    static const unsigned UPLOAD_WINDOW = 4;
+    unsigned _chunksInFlight;
 
     // void startConnection(const std::function<void()>& onConnect);
     void afterConnect();
@@ -109,21 +162,150 @@ private:
     void afterReceiveLoginChallenge(const std::string& line);
     void afterSendLoginChallengeResponse();
     void afterReceiveLoginChallengeAck(const std::string& line);
+    void afterSendFramingRequest();
+    void afterReceiveFramingResponse(const std::string& line);
+    void finishConnecting();
 
     void issueRetrieveTasksRequest();
+    void issueRetrieveTaskChangesRequest(int sinceVersion);
+    void afterSendRetrieveTaskChangesRequest();
+    void receiveTaskChangesHeader(const std::string& line);
     void startReceivingTasks();
-    void receiveTaskHeader(const std::string& line);
-    void receiveTaskDescription(const std::string& line);
+    void receiveTaskLine(const std::string& line);
+    bool handleTaskLine(const std::string& line);
+    void receiveTasksFrame(boost::string_view payload);
+    void receiveRemovedTasksFrame(boost::string_view payload);
+    void finishReceivingTasks();
 
     void issueSendLogsRequest();
     void readLastTimestamp();
     void startSendingLogs(const std::string& line);
-    void sendLogEntry();
-    void sendNextLogEntry();
+    void issueSendLogsResumableRequest();
+    void readLastSequence();
+    void startSendingLogsResumable(const std::string& line);
+    void startUpload();
+    bool nextLogEntry(std::string& chunk);
+    void sendLogEntries();
+    void afterSendLogChunk();
+    void receiveLogAck(const std::string& line);
+    bool handleLogAck(const std::string& line);
     void finishSendingLogs();
 
     void handleProtocolError(const std::string& errorMsg, const std::string& line);
     void handleError(const std::string& errorMsg);
 };
 
+struct ServerCallbacks
+{
+    typedef std::function<boost::optional<std::string>(const std::string&)> FindPasswordCallback;
+    // error message, empty if client may go on
+    typedef std::function<void(const std::string&)> LoginDoneCallback;
+    typedef std::function<void(const std::string&, const std::string&, const LoginDoneCallback&)> LoginCallback;
+    typedef std::function<std::string(bool)> RetrieveTasksCallback;
+    typedef std::function<TaskListDelta(int)> RetrieveTaskChangesCallback;
+    typedef std::function<boost::optional<Timestamp>()> LastLogEntryTimeCallback;
+    typedef std::function<void(LogEntry&&)> LogEntryCallback;
+    // error message, empty if every received entry was stored
+    typedef std::function<void(const std::string&)> LogsStoredCallback;
+    typedef std::function<void(const LogsStoredCallback&)> LogsReceivedCallback;
+    typedef std::function<int()> SequenceCallback;
+    typedef std::function<int(boost::optional<Timestamp>&)> LastSequenceCallback;
+    typedef std::function<void(int, LogEntry&&)> SequencedLogEntryCallback;
+
+    // returns password of given employee, none if employee can't log in
+    FindPasswordCallback _findPassword;
+    // called with client uuid and employee id after successful authentication, given callback has to be
+    // called on connection's thread (possibly at once); connection waits for it before reading first command
+    LoginCallback _onLogin;
+    // returns complete response to RETRIEVE TASKS in binary (true) or text framing,
+    // see formatTasksFrames and formatTasksText
+    RetrieveTasksCallback _retrieveTasks;
+    // returns changes of task list since given version
+    RetrieveTaskChangesCallback _retrieveTaskChanges;
+    LastLogEntryTimeCallback _lastLogEntryTime;
+    LogEntryCallback _onLogEntry;
+    // ends the upload, given callback has to be called on connection's thread (possibly at once)
+    // when entries are stored; connection waits for it before reading next command
+    LogsReceivedCallback _onLogsReceived;
+    // LOG UPLOAD RESUMABLE: entries come with sequence numbers instead of going to _onLogEntry,
+    // _onLogsReceived ends the upload as well
+    // returns sequence number of last entry of this client stored before the upload, starts the upload;
+    // when it's 0 also fills time of last entry stored by LOG UPLOAD, if any
+    LastSequenceCallback _lastSequence;
+    SequencedLogEntryCallback _onSequencedLogEntry;
+    // returns sequence number of last entry stored so far, polled to send acknowledgements
+    SequenceCallback _committedSequence;
+};
+
+// Server end of the protocol, non-blocking counterpart of ClientConnection in StacjaSzefa.
+// Exceptions thrown by callbacks close the connection.
+class AsyncServerConnection
+{
+public:
+    typedef std::function<void(const std::string&)> ErrorCallback;
+
+    AsyncServerConnection(MainLoop& mainLoop,
+                          Descriptor&& fd,
+                          const std::string& serverUuid,
+                          bool allowBinaryFraming,
+                          const ServerCallbacks& callbacks,
+                          const ErrorCallback& onError);
+    ~AsyncServerConnection();
+
+    void start();
+    void stop();
+private:
+    MainLoop& _mainLoop;
+    const std::string& _serverUuid;
+    ServerCallbacks _callbacks;
+    ErrorCallback _onErrorHook;
+    AsyncSocket _conn;
+    bool _running;
+    bool _allowBinaryFraming;
+    bool _binaryFraming;
+
+    std::string _clientChallenge;
+    std::string _clientUuid;
+    std::string _userId;
+    std::string _password;
+    std::string _loginChallenge;
+
+    // state of LOG UPLOAD RESUMABLE
+    bool _resumableUpload;
+    int _lastReceivedSequence;
+    int _acknowledgedSequence;
+
+    void afterReceiveServerChallenge(const std::string& line);
+    void afterSendServerChallengeResponse();
+    void afterReceiveServerChallengeAck(const std::string& line);
+    void afterSendClientChallenge();
+    void afterReceiveClientChallengeResponse(const std::string& line);
+    void afterSendClientChallengeAck();
+    void afterReceiveClientUuid(const std::string& line);
+    void afterReceiveLoginRequest(const std::string& line);
+    void afterSendLoginChallenge();
+    void afterReceiveLoginChallengeResponse(const std::string& line);
+    void afterSendLoginChallengeAck();
+    void afterLogin(const std::string& errorMsg);
+
+    void awaitCommand();
+    void handleCommand(const std::string& line);
+    void sendTasks();
+    void sendTaskChanges(int sinceVersion);
+    void startReceivingLogs();
+    void startReceivingLogsResumable();
+    void readLogs();
+    void receiveLogEntry(const std::string& line);
+    bool handleLogEntry(const std::string& line);
+    void receiveLogFrame(boost::string_view payload);
+    bool handleLogFrame(boost::string_view payload);
+    bool handleSequencedLogEntry(int sequence, LogEntry&& entry);
+    void acknowledgeLogs();
+    void finishReceivingLogs();
+    void afterLogsStored(const std::string& errorMsg);
+
+    void handleProtocolError(const std::string& errorMsg, const std::string& line);
+    void handleError(const std::string& errorMsg);
+};
+
 #endif // PROTOCOL_H
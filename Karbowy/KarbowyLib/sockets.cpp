@@ -1,7 +1,9 @@
 #include "sockets.h"
 #include "systemerror.h"
+#include "framing.h"
 
 #include <netdb.h>
+#include <netinet/tcp.h>
 #include <unistd.h>
 #include <string.h>
 
@@ -101,6 +103,12 @@ Descriptor::operator int() const
     return _fd;
 }
 
+bool Descriptor::setNoDelay()
+{
+    int on = 1;
+    return setsockopt(_fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)) == 0;
+}
+
 void Descriptor::close()
 {
     if (_fd >= 0)
@@ -110,7 +118,10 @@ void Descriptor::close()
 }
 
 TcpStream::TcpStream(Descriptor&& fd) :
-    _fd(std::forward<Descriptor>(fd)) { }
+    _fd(std::forward<Descriptor>(fd)),
+    _readChunkSize(DEFAULT_READ_CHUNK_SIZE),
+    _buffered(false),
+    _flushThreshold(0) { }
 
 
 TcpStream TcpStream::connect(const Ipv4Address& address)
@@ -141,69 +152,192 @@ TcpStream TcpStream::connect(const Ipv6Address& address)
     return TcpStream(std::move(fd));
 }
 
-std::string TcpStream::readLine()
+void TcpStream::setReadChunkSize(size_t size)
 {
+    assert(size > 0);
+    _readChunkSize = size;
+}
+
+void TcpStream::setBuffered(size_t flushThreshold)
+{
+    _buffered = true;
+    _flushThreshold = flushThreshold;
+}
+
+bool TcpStream::fillBuffer()
+{
+    if (_buffer.eofReceived())
+    {
+        return false;
+    }
+
+    // peer is probably waiting for our pending output before it sends anything
+    flush();
+
+    char* chunk = _buffer.prepare(_readChunkSize);
+    ssize_t readBytes = read(_fd, chunk, _readChunkSize);
+    if (readBytes < 0)
+    {
+        throw SystemError("read error");
+    }
+    else if (readBytes == 0)
+    {
+        _buffer.setEof();
+        return false;
+    }
+    else
+    {
+        _buffer.commit(readBytes);
+        return true;
+    }
+}
 
+std::string TcpStream::readLine()
+{
     while (! _buffer.hasFullLine())
     {
-        if (_buffer.isEof())
+        if (! fillBuffer() && _buffer.isEof())
         {
             throw std::runtime_error("EOF");
         }
+    }
 
-        static const size_t chunkSize = 1024;
+    return _buffer.getFirstLine();
+}
 
-        char chunk[chunkSize];
-        ssize_t readBytes = read(_fd, chunk, chunkSize);
-        if (readBytes < 0)
-        {
-            throw SystemError("read error");
-        }
-        else if (readBytes == 0)
+std::string TcpStream::readFrame()
+{
+    while (! _buffer.hasFullFrame())
+    {
+        if (_buffer.hasFrameHeader() && _buffer.firstFrameSize() > MAX_FRAME_SIZE)
         {
-            _buffer.setEof();
+            throw std::runtime_error("Frame too large");
         }
-        else
+        if (! fillBuffer())
         {
-            _buffer.addData(chunk, readBytes);
+            throw std::runtime_error("EOF");
         }
     }
 
-    return _buffer.getFirstLine();
+    boost::string_view payload = _buffer.getFirstFrameView();
+    return std::string(payload.data(), payload.size());
 }
 
-void TcpStream::writeLine(const std::string line)
+static void sendAll(int fd, const char* data, size_t length, int flags)
 {
-    ssize_t writeBytes = 0;
-    unsigned length = line.length();
-    const char* charLine = line.c_str();
-    while (writeBytes != line.length())
+    size_t sentBytes = 0;
+    while (sentBytes < length)
     {
-        ssize_t written = write(_fd, charLine + writeBytes, length - writeBytes);
-        if (written < 0)
+        ssize_t sent = send(fd, data + sentBytes, length - sentBytes, flags | MSG_NOSIGNAL);
+        if (sent < 0)
         {
+            if (errno == EINTR)
+            {
+                continue;
+            }
             throw SystemError("write error");
         }
-        else
+        sentBytes += sent;
+    }
+}
+
+void TcpStream::writeLine(const std::string& line)
+{
+    write(line);
+}
+
+void TcpStream::write(const std::string& data)
+{
+    write(data.data(), data.size());
+}
+
+void TcpStream::write(const char* data, size_t size)
+{
+    if (! _buffered)
+    {
+        sendAll(_fd, data, size, 0);
+        return;
+    }
+    _outputBuffer.append(data, size);
+    flushIfAboveThreshold();
+}
+
+void TcpStream::flushIfAboveThreshold()
+{
+    if (_outputBuffer.size() >= _flushThreshold)
+    {
+        // more data will follow, let kernel fill full segments
+        sendAll(_fd, _outputBuffer.data(), _outputBuffer.size(), MSG_MORE);
+        _outputBuffer.clear();
+    }
+}
+
+void TcpStream::flush()
+{
+    if (! _outputBuffer.empty())
+    {
+        sendAll(_fd, _outputBuffer.data(), _outputBuffer.size(), 0);
+        _outputBuffer.clear();
+    }
+}
+
+int Listener::descriptor() const
+{
+    return _fd;
+}
+
+Descriptor Listener::tryAccept()
+{
+    Descriptor fd(accept4(_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC));
+    if (fd < 0)
+    {
+        switch (errno)
         {
-            writeBytes += written;
+        case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+        case EWOULDBLOCK:
+#endif
+        case ECONNABORTED:
+        case EINTR:
+            break;
+        default:
+            throw SystemError("accept error");
         }
     }
+    // replies of request-response protocol are small, delayed by Nagle they would wait for peer's delayed ACK
+    else if (! fd.setNoDelay())
+    {
+        throw SystemError("setsockopt TCP_NODELAY error");
+    }
+    return fd;
 }
 
-Ipv4Listener::Ipv4Listener(uint16_t port) :
-    _fd(socket(AF_INET, SOCK_STREAM, 0))
+void Listener::setReusePort()
 {
+    int on = 1;
+    if (setsockopt(_fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) < 0)
+    {
+        throw SystemError("setsockopt SO_REUSEPORT error");
+    }
+}
+
+Ipv4Listener::Ipv4Listener(uint16_t port, int backlog, bool reusePort)
+{
+    _fd = Descriptor(socket(AF_INET, SOCK_STREAM, 0));
     if(_fd < 0)
     {
         throw SystemError("IPv4 socket error");
     }
+    if (reusePort)
+    {
+        setReusePort();
+    }
     Ipv4Address address = Ipv4Address::any(port);
     if(bind(_fd, address.address(), address.length()) < 0)
     {
         throw SystemError("IPv4 bind error");
     }
-    if(listen(_fd, 20) < 0)
+    if(listen(_fd, backlog) < 0)
     {
         throw SystemError("IPv4 listen error");
     }
@@ -219,9 +353,9 @@ TcpStream Ipv4Listener::awaitConnection()
     return TcpStream(std::move(fd));
 }
 
-Ipv6Listener::Ipv6Listener(uint16_t port) :
-    _fd(socket(AF_INET6, SOCK_STREAM, 0))
+Ipv6Listener::Ipv6Listener(uint16_t port, int backlog, bool reusePort)
 {
+    _fd = Descriptor(socket(AF_INET6, SOCK_STREAM, 0));
     if(_fd < 0)
     {
         throw SystemError("IPv6 socket error");
@@ -231,12 +365,16 @@ Ipv6Listener::Ipv6Listener(uint16_t port) :
     {
         throw SystemError("IPv6 setsockopt error");
     }
+    if (reusePort)
+    {
+        setReusePort();
+    }
     Ipv6Address address = Ipv6Address::any(port);
     if(bind(_fd, address.address(), address.length()) < 0)
     {
         throw SystemError("IPv6 bind error");
     }
-    if(listen(_fd, 20) < 0)
+    if(listen(_fd, backlog) < 0)
     {
         throw SystemError("IPv6 listen error");
     }
@@ -5,6 +5,7 @@
 #include <netinet/ip.h>
 
 #include "linebuffer.h"
+#include "concat.h"
 
 class Ipv4Address
 {
@@ -62,6 +63,8 @@ public:
     ~Descriptor();
 
     operator int() const;
+    // disables Nagle's algorithm on TCP socket; on failure returns false with errno set
+    bool setNoDelay();
 
 protected:
     static const int INVALID_DESCRIPTOR = -1;
@@ -83,11 +86,37 @@ public:
     TcpStream& operator=(const TcpStream& other) = delete;
     TcpStream& operator=(TcpStream&& other) = default;
 
+    static const size_t DEFAULT_READ_CHUNK_SIZE = 4096;
+    static const size_t DEFAULT_FLUSH_THRESHOLD = 16 * 1024;
+
+    // maximum number of bytes requested from kernel by single read
+    void setReadChunkSize(size_t size);
+    // in buffered mode written lines are collected and sent when there is more than flushThreshold
+    // of them, on flush() or before readLine() has to wait for data; unbuffered stream writes each line at once
+    void setBuffered(size_t flushThreshold = DEFAULT_FLUSH_THRESHOLD);
+
     std::string readLine();
-    void writeLine(std::string);
+    // returns payload of next binary frame (see framing.h)
+    std::string readFrame();
+    void writeLine(const std::string& line);
+    // formats line with concatlnTo straight into output buffer, without temporary string
+    template <typename... Args>
+    void writeLineOf(const Args&... args);
+    // writes data as is, e.g. encoded frames
+    void write(const std::string& data);
+    void write(const char* data, size_t size);
+    void flush();
 private:
     Descriptor _fd;
     LineBuffer _buffer;
+    size_t _readChunkSize;
+    bool _buffered;
+    size_t _flushThreshold;
+    std::string _outputBuffer;
+
+    // reads at least some bytes into buffer, returns false on EOF
+    bool fillBuffer();
+    void flushIfAboveThreshold();
 
     TcpStream(Descriptor&& fd);
 
@@ -95,31 +124,55 @@ private:
     friend class Ipv6Listener;
 };
 
+template <typename... Args>
+void TcpStream::writeLineOf(const Args&... args)
+{
+    if (_buffered)
+    {
+        concatlnTo(_outputBuffer, args...);
+        flushIfAboveThreshold();
+    }
+    else
+    {
+        thread_local std::string line;
+        line.clear();
+        concatlnTo(line, args...);
+        write(line.data(), line.size());
+    }
+}
+
 class Listener
 {
 public:
+    static const int DEFAULT_BACKLOG = 20;
+
     virtual ~Listener() { }
     virtual TcpStream awaitConnection() = 0;
+
+    int descriptor() const;
+    // returns invalid descriptor if there is no pending connection on non-blocking listener
+    Descriptor tryAccept();
+protected:
+    Descriptor _fd;
+
+    void setReusePort();
 };
 
 class Ipv4Listener : public Listener
 {
 public:
-    Ipv4Listener(uint16_t port);
+    // with reusePort many listeners may be bound to the same port, kernel spreads connections among them
+    Ipv4Listener(uint16_t port, int backlog = DEFAULT_BACKLOG, bool reusePort = false);
 
     TcpStream awaitConnection() override;
-private:
-    Descriptor _fd;
 };
 
 class Ipv6Listener : public Listener
 {
 public:
-    Ipv6Listener(uint16_t port);
+    Ipv6Listener(uint16_t port, int backlog = DEFAULT_BACKLOG, bool reusePort = false);
 
     TcpStream awaitConnection() override;
-private:
-    Descriptor _fd;
 };
 
 #endif
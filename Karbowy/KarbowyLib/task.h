@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <memory>
 #include "timestamp.h"
 
 struct ClientTask
@@ -12,10 +13,26 @@ struct ClientTask
     std::vector<std::string> _description;
     Duration _timeSpent;
     Timestamp _lastCheckpoint;
+    // moment up to which _timeSpent is stored in the database
+    Timestamp _lastPersisted;
     bool _workingNow;
 
     ClientTask() = default;
     ClientTask(int id, std::string&& title, const std::string& description, Duration timeSpent);
 };
 
+// Changes of employee's task list since given version of server's task data,
+// response to RETRIEVE TASKS SINCE.
+struct TaskListDelta
+{
+    // version to ask for next time
+    int _version;
+    // _changed holds all active tasks, tasks not listed should be dropped
+    bool _complete;
+    // tasks to insert or update
+    std::vector<std::unique_ptr<ClientTask> > _changed;
+    // tasks finished, canceled or no longer assigned
+    std::vector<int> _removed;
+};
+
 #endif
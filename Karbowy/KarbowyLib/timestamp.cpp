@@ -1,23 +1,163 @@
 #include "timestamp.h"
-#include <boost/format.hpp>
-#include <sstream>
+#include <string.h>
 
 int toSeconds(Duration duration)
 {
     return std::chrono::duration_cast<std::chrono::seconds>(duration).count();
 }
 
-std::string formatTimestamp(const Timestamp &timestamp)
+static const int64_t MILLIS_PER_DAY = 24 * 60 * 60 * 1000;
+// length of "YYYY-MM-DD "
+static const size_t DATE_PREFIX_LENGTH = 11;
+
+// days since 1970-01-01 of given proleptic Gregorian date (H. Hinnant's days_from_civil)
+static int64_t daysFromCivil(int year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+}
+
+// inverse of daysFromCivil
+static void civilFromDays(int64_t days, int& year, unsigned& month, unsigned& day)
+{
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+    const unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const unsigned mp = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * mp + 2) / 5 + 1;
+    month = mp < 10 ? mp + 3 : mp - 9;
+    year = static_cast<int>(yearOfEra + era * 400) + (month <= 2);
+}
+
+static unsigned daysInMonth(int year, unsigned month)
+{
+    static const unsigned days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return month == 2 && leap ? 29 : days[month - 1];
+}
+
+static void writeDigits(char* buffer, unsigned value, int count)
+{
+    for (int i = count - 1; i >= 0; --i)
+    {
+        buffer[i] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    }
+}
+
+static bool readDigits(const char* text, int count, unsigned& value)
+{
+    value = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        unsigned digit = static_cast<unsigned char>(text[i]) - '0';
+        if (digit > 9)
+        {
+            return false;
+        }
+        value = 10 * value + digit;
+    }
+    return true;
+}
+
+std::string formatTimestamp(const Timestamp& timestamp)
 {
-    time_t time = Clock::to_time_t(timestamp);
-    tm t;
-    if (gmtime_r(&time, &t) == nullptr)
+    char buffer[TIMESTAMP_LENGTH];
+    formatTimestamp(timestamp, buffer);
+    return std::string(buffer, TIMESTAMP_LENGTH);
+}
+
+char* formatTimestamp(const Timestamp& timestamp, char* buffer)
+{
+    struct DateCache
+    {
+        int64_t _days;
+        char _prefix[DATE_PREFIX_LENGTH];
+    };
+    static thread_local DateCache cache = { INT64_MIN, { } };
+
+    int64_t millis = toEpochMilliseconds(timestamp);
+    int64_t days = millis / MILLIS_PER_DAY;
+    int64_t millisOfDay = millis % MILLIS_PER_DAY;
+    if (millisOfDay < 0)
+    {
+        millisOfDay += MILLIS_PER_DAY;
+        --days;
+    }
+    if (days != cache._days)
+    {
+        int year;
+        unsigned month, day;
+        civilFromDays(days, year, month, day);
+        writeDigits(cache._prefix, static_cast<unsigned>(year), 4);
+        cache._prefix[4] = '-';
+        writeDigits(cache._prefix + 5, month, 2);
+        cache._prefix[7] = '-';
+        writeDigits(cache._prefix + 8, day, 2);
+        cache._prefix[10] = ' ';
+        cache._days = days;
+    }
+    memcpy(buffer, cache._prefix, DATE_PREFIX_LENGTH);
+
+    unsigned ms = static_cast<unsigned>(millisOfDay);
+    char* time = buffer + DATE_PREFIX_LENGTH;
+    writeDigits(time, ms / 3600000, 2);
+    time[2] = ':';
+    writeDigits(time + 3, ms / 60000 % 60, 2);
+    time[5] = ':';
+    writeDigits(time + 6, ms / 1000 % 60, 2);
+    time[8] = '.';
+    writeDigits(time + 9, ms % 1000, 3);
+    return buffer + TIMESTAMP_LENGTH;
+}
+
+bool parseTimestamp(const char* text, Timestamp& timestamp)
+{
+    struct DateCache
+    {
+        char _prefix[DATE_PREFIX_LENGTH];
+        int64_t _days;
+        bool _valid;
+    };
+    static thread_local DateCache cache = { { }, 0, false };
+
+    int64_t days;
+    if (cache._valid && memcmp(text, cache._prefix, DATE_PREFIX_LENGTH) == 0)
+    {
+        days = cache._days;
+    }
+    else
+    {
+        unsigned year, month, day;
+        if (! readDigits(text, 4, year) || text[4] != '-' ||
+            ! readDigits(text + 5, 2, month) || text[7] != '-' ||
+            ! readDigits(text + 8, 2, day) || text[10] != ' ' ||
+            month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month))
+        {
+            return false;
+        }
+        days = daysFromCivil(year, month, day);
+        memcpy(cache._prefix, text, DATE_PREFIX_LENGTH);
+        cache._days = days;
+        cache._valid = true;
+    }
+
+    const char* time = text + DATE_PREFIX_LENGTH;
+    unsigned hour, minute, second, millis;
+    if (! readDigits(time, 2, hour) || time[2] != ':' ||
+        ! readDigits(time + 3, 2, minute) || time[5] != ':' ||
+        ! readDigits(time + 6, 2, second) || time[8] != '.' ||
+        ! readDigits(time + 9, 3, millis) ||
+        hour > 23 || minute > 59 || second > 59)
     {
-        throw std::runtime_error("gmtime_r error");
+        return false;
     }
-    int milis = std::chrono::duration_cast<std::chrono::milliseconds>(timestamp - Clock::from_time_t(time)).count();
-    std::ostringstream stream;
-    stream << boost::format("%04d-%02d-%02d %02d:%02d:%02d.%03d") % (t.tm_year + 1900) % (t.tm_mon + 1) % t.tm_mday
-                                                                  % t.tm_hour  % t.tm_min % t.tm_sec %  milis;
-    return stream.str();
+    timestamp = fromEpochMilliseconds(days * MILLIS_PER_DAY + ((hour * 60 + minute) * 60 + second) * 1000 + millis);
+    return true;
 }
@@ -3,12 +3,33 @@
 
 #include <chrono>
 #include <string>
+#include <cstdint>
 
 typedef std::chrono::system_clock Clock;
 typedef Clock::time_point Timestamp;
 typedef Clock::duration Duration;
 
 int toSeconds(Duration duration);
+
+// Text form of timestamps is "YYYY-MM-DD hh:mm:ss.mmm" in UTC. Conversions use civil date
+// arithmetic instead of gmtime/mktime, date part of the last converted day is cached per thread.
+static const size_t TIMESTAMP_LENGTH = 23;
+
 std::string formatTimestamp(const Timestamp& timestamp);
+// writes exactly TIMESTAMP_LENGTH chars (without terminating zero), returns pointer past them
+char* formatTimestamp(const Timestamp& timestamp, char* buffer);
+// parses exactly TIMESTAMP_LENGTH chars
+bool parseTimestamp(const char* text, Timestamp& timestamp);
+
+// representation used in database
+inline int64_t toEpochMilliseconds(const Timestamp& timestamp)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(timestamp.time_since_epoch()).count();
+}
+
+inline Timestamp fromEpochMilliseconds(int64_t millis)
+{
+    return Timestamp(std::chrono::duration_cast<Duration>(std::chrono::milliseconds(millis)));
+}
 
 #endif
@@ -6,11 +6,30 @@ CONFIG -= qt
 SOURCES += \
     linebuffer.cpp \
     gtest_main.cc \
-    sockets.cpp
+    eventdispatcher.cpp \
+    sockets.cpp \
+    database.cpp \
+    framing.cpp \
+    parse.cpp \
+    timestamp.cpp \
+    concat.cpp \
+    resumableupload.cpp \
+    logupload.cpp \
+    taskretrieval.cpp \
+    logstorage.cpp \
+    protocoltest.cpp \
+    ../StacjaSzefa/predefinedqueries.cpp \
+    ../StacjaSzefa/sessionhelpers.cpp \
+    ../StacjaSzefa/logingestor.cpp \
+    ../StacjaSzefa/logprocessor.cpp \
+    ../StacjaSzefa/tasklistcache.cpp
+
+HEADERS += \
+    protocoltest.h
 
 LIBS += -L$$OUT_PWD/../KarbowyLib/ -lKarbowyLib
 
-INCLUDEPATH += $$PWD/../KarbowyLib
+INCLUDEPATH += $$PWD/../KarbowyLib $$PWD/../StacjaSzefa
 DEPENDPATH += $$PWD/../KarbowyLib
 
 LIBS += -L$$OUT_PWD/../gtest/ -lgtest
@@ -20,4 +39,7 @@ DEPENDPATH += $$PWD/../gtest
 
 PRE_TARGETDEPS += $$OUT_PWD/../gtest/libgtest.a
 
+unix: CONFIG += link_pkgconfig
+unix: PKGCONFIG += sqlite3
+
 LIBS += -lpthread
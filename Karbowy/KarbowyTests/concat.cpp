@@ -0,0 +1,19 @@
+#include <gtest/gtest.h>
+#include "concat.h"
+#include <climits>
+
+TEST(ConcatTest, FormatsLikeStream)
+{
+    EXPECT_EQ(concat("int ", 0, ' ', -42, ' ', INT_MIN, ' ', ULLONG_MAX, ' ', std::string("str"), ' ', 1.5),
+              "int 0 -42 -2147483648 18446744073709551615 str 1.5");
+    EXPECT_EQ(concatln("TASK ", 7, " START"), "TASK 7 START\n");
+    EXPECT_EQ(concat(fromEpochMilliseconds(1463307630456)), "2016-05-15 10:20:30.456");
+}
+
+TEST(ConcatTest, AppendsToBuffer)
+{
+    std::string buffer = "first\n";
+    concatlnTo(buffer, "second ", 2);
+    concatTo(buffer, "third");
+    EXPECT_EQ(buffer, "first\nsecond 2\nthird");
+}
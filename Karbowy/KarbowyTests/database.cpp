@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "database.h"
+#include "databasewriter.h"
+#include <vector>
+
+class DatabaseTest : public ::testing::Test
+{
+protected:
+    Database _db;
+
+    DatabaseTest() :
+        _db(":memory:")
+    {
+        _db.execute("CREATE TABLE Items (value INTEGER)");
+    }
+
+    int countItems()
+    {
+        Query<int> query(_db, "SELECT COUNT(*) FROM Items");
+        query.execute();
+        int count = -1;
+        query.next(count);
+        while (query.next(count)) { }
+        return count;
+    }
+};
+
+TEST_F(DatabaseTest, CommitKeepsChanges)
+{
+    Command<int> insert(_db, "INSERT INTO Items(value) VALUES (?)");
+    {
+        Transaction transaction(_db);
+        insert.execute(1);
+        insert.execute(2);
+        transaction.commit();
+    }
+    EXPECT_EQ(countItems(), 2);
+}
+
+TEST_F(DatabaseTest, RollbackOnDestruction)
+{
+    Command<int> insert(_db, "INSERT INTO Items(value) VALUES (?)");
+    {
+        Transaction transaction(_db);
+        insert.execute(1);
+    }
+    EXPECT_EQ(countItems(), 0);
+}
+
+TEST_F(DatabaseTest, StatementCacheReusesPreparedStatement)
+{
+    static const char* txt = "INSERT INTO Items(value) VALUES (?)";
+    auto& first = _db.statement<Command<int> >(txt);
+    auto& second = _db.statement<Command<int> >(std::string(txt).c_str());
+    EXPECT_EQ(&first, &second);
+    first.execute(1);
+    second.execute(2);
+    EXPECT_EQ(countItems(), 2);
+}
+
+TEST_F(DatabaseTest, WriterIsolatesFailingJob)
+{
+    DatabaseWriter writer([this]() -> Database& { return _db; });
+    writer.start();
+    std::vector<std::future<void> > results;
+    for (int i = 0; i < 10; ++i)
+    {
+        results.push_back(writer.submit([i](Database& db)
+        {
+            db.statement<Command<int> >("INSERT INTO Items(value) VALUES (?)").execute(i);
+            if (i == 5)
+            {
+                throw std::runtime_error("job failed");
+            }
+        }));
+    }
+    writer.stop();
+    for (int i = 0; i < 10; ++i)
+    {
+        if (i == 5)
+        {
+            EXPECT_THROW(results[i].get(), std::runtime_error);
+        }
+        else
+        {
+            EXPECT_NO_THROW(results[i].get());
+        }
+    }
+    EXPECT_EQ(countItems(), 9);
+}
+
+TEST_F(DatabaseTest, WriterCompletesJobsInOrder)
+{
+    DatabaseWriter writer([this]() -> Database& { return _db; });
+    writer.start();
+    std::vector<std::future<void> > results;
+    for (int i = 0; i < 10; ++i)
+    {
+        results.push_back(writer.submit([i](Database& db)
+        {
+            db.statement<Command<int> >("INSERT INTO Items(value) VALUES (?)").execute(i);
+        }));
+    }
+    // handler of last job sees results of all earlier ones
+    bool earlierReady = false;
+    auto last = writer.submit([](Database&) { }, [&]()
+    {
+        earlierReady = true;
+        for (auto& result : results)
+        {
+            earlierReady = earlierReady && result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }
+    });
+    last.get();
+    EXPECT_TRUE(earlierReady);
+    writer.stop();
+    EXPECT_EQ(countItems(), 10);
+}
+
+TEST_F(DatabaseTest, TimestampStoredAsEpochMilliseconds)
+{
+    Timestamp timestamp = fromEpochMilliseconds(1464000123456);
+    _db.execute("CREATE TABLE Times (value DATETIME)");
+    Command<Timestamp> insert(_db, "INSERT INTO Times(value) VALUES (?)");
+    insert.execute(timestamp);
+    Query<std::string> type(_db, "SELECT typeof(value) FROM Times");
+    type.execute();
+    std::string typeName;
+    ASSERT_TRUE(type.next(typeName));
+    EXPECT_EQ(typeName, "integer");
+    while (type.next(typeName)) { }
+    Query<Timestamp> select(_db, "SELECT value FROM Times");
+    select.execute();
+    Timestamp result;
+    ASSERT_TRUE(select.next(result));
+    EXPECT_EQ(result, timestamp);
+    while (select.next(result)) { }
+}
+
+TEST_F(DatabaseTest, MigratingTextTimestamps)
+{
+    Timestamp timestamp = fromEpochMilliseconds(1464000123456);
+    _db.execute("CREATE TABLE Times (value DATETIME)");
+    Command<std::string> insert(_db, "INSERT INTO Times(value) VALUES (?)");
+    insert.execute(formatTimestamp(timestamp));
+    Query<Timestamp> select(_db, "SELECT value FROM Times");
+    select.execute();
+    Timestamp result;
+    ASSERT_TRUE(select.next(result));
+    EXPECT_EQ(result, timestamp);
+    while (select.next(result)) { }
+
+    static const char* migrations[] = {
+        "UPDATE Times SET value = CAST(strftime('%s', value) AS INTEGER) * 1000 + CAST(substr(value, 21, 3) AS INTEGER)\n"
+        "WHERE typeof(value) = 'text';\n"
+    };
+    migrateDatabase(_db, migrations, 1);
+    migrateDatabase(_db, migrations, 1);
+    Query<std::string> type(_db, "SELECT typeof(value) FROM Times");
+    type.execute();
+    std::string typeName;
+    ASSERT_TRUE(type.next(typeName));
+    EXPECT_EQ(typeName, "integer");
+    while (type.next(typeName)) { }
+    select.execute();
+    ASSERT_TRUE(select.next(result));
+    EXPECT_EQ(result, timestamp);
+    while (select.next(result)) { }
+}
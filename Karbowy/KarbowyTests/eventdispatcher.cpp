@@ -0,0 +1,208 @@
+#include <gtest/gtest.h>
+#include "eventdispatcher.h"
+#include "sockets.h"
+#include <sys/resource.h>
+#include <sys/select.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <thread>
+
+class PipeReader : public WaitableObject
+{
+public:
+    PipeReader(int minFd = 0) :
+        _bytesRead(0)
+    {
+        int fds[2];
+        if (pipe2(fds, O_NONBLOCK) < 0)
+        {
+            throw std::runtime_error("pipe error");
+        }
+        _readFd = Descriptor(fcntl(fds[0], F_DUPFD, minFd));
+        ::close(fds[0]);
+        _writeFd = Descriptor(fds[1]);
+        waitFor(WaitFor_READ);
+    }
+
+    ~PipeReader()
+    {
+        detach();
+    }
+
+    void write(char c)
+    {
+        ASSERT_EQ(::write(_writeFd, &c, 1), 1);
+    }
+
+    int readFd() const
+    {
+        return _readFd;
+    }
+
+    int _bytesRead;
+    std::function<void()> _onRead;
+
+private:
+    Descriptor _readFd;
+    Descriptor _writeFd;
+
+    int descriptor() const override
+    {
+        return _readFd;
+    }
+
+    void onReadyToRead() override
+    {
+        char buffer[16];
+        ssize_t res;
+        while ((res = ::read(_readFd, buffer, sizeof(buffer))) > 0)
+        {
+            _bytesRead += res;
+        }
+        waitFor(WaitFor_READ);
+        if (_onRead)
+        {
+            _onRead();
+        }
+    }
+
+    void onReadyToWrite() override
+    {
+        FAIL();
+    }
+};
+
+class MainLoopTest : public testing::Test
+{
+protected:
+    MainLoop _loop;
+    TaskQueue _queue;
+
+    void SetUp() override
+    {
+        _loop.addObject(_queue);
+        _loop.start();
+    }
+
+    void TearDown() override
+    {
+        _loop.removeAllObjects();
+    }
+};
+
+TEST_F(MainLoopTest, ExecutesQueuedTasks)
+{
+    int counter = 0;
+    _queue.addTask([&counter] { ++counter; });
+    _queue.addTask([&counter] { ++counter; });
+    _queue.addTask([this] { _loop.exit(); });
+    _loop.run();
+    EXPECT_EQ(counter, 2);
+}
+
+TEST_F(MainLoopTest, DispatchesOnlyReadyObjects)
+{
+    std::vector<std::unique_ptr<PipeReader> > readers;
+    for (int i = 0; i < 100; ++i)
+    {
+        readers.emplace_back(std::make_unique<PipeReader>());
+        _loop.addObject(*readers.back());
+    }
+    readers[42]->_onRead = [this] { _loop.exit(); };
+    readers[42]->write('x');
+    _loop.run();
+    for (size_t i = 0; i < readers.size(); ++i)
+    {
+        EXPECT_EQ(readers[i]->_bytesRead, i == 42 ? 1 : 0);
+    }
+}
+
+TEST_F(MainLoopTest, RemovingObjectFromAnotherObjectsHandler)
+{
+    PipeReader first, second;
+    _loop.addObject(first);
+    _loop.addObject(second);
+    first._onRead = [&] { second.detach(); first.detach(); _loop.exit(); };
+    second._onRead = [&] { first.detach(); second.detach(); _loop.exit(); };
+    first.write('a');
+    second.write('b');
+    _loop.run();
+    EXPECT_EQ(first._bytesRead + second._bytesRead, 1);
+}
+
+TEST_F(MainLoopTest, DescriptorAboveFdSetSize)
+{
+    rlimit limit;
+    ASSERT_EQ(getrlimit(RLIMIT_NOFILE, &limit), 0);
+    if (limit.rlim_cur <= FD_SETSIZE + 1)
+    {
+        limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, 2 * FD_SETSIZE);
+        ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &limit), 0);
+    }
+    ASSERT_GT(limit.rlim_cur, static_cast<rlim_t>(FD_SETSIZE + 1));
+
+    PipeReader reader(FD_SETSIZE + 1);
+    ASSERT_GT(reader.readFd(), FD_SETSIZE);
+    _loop.addObject(reader);
+    reader._onRead = [this] { _loop.exit(); };
+    reader.write('x');
+    _loop.run();
+    EXPECT_EQ(reader._bytesRead, 1);
+}
+
+TEST_F(MainLoopTest, QueuedWritesArriveInOrder)
+{
+    int fds[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds), 0);
+    Descriptor peer(fds[1]);
+    ASSERT_EQ(fcntl(peer, F_SETFL, 0), 0);
+    AsyncSocket socket(Descriptor(fds[0]), [](const std::string& msg) { FAIL() << msg; });
+    _loop.addObject(socket);
+
+    std::string expected;
+    int completed = 0;
+    for (int i = 0; i < 10000; ++i)
+    {
+        std::string line = std::to_string(i) + std::string(100, 'x') + '\n';
+        expected += line;
+        socket.asyncWrite(line, [&completed] { ++completed; });
+    }
+    socket.asyncWrite("", [this] { _loop.exit(); });
+
+    std::string received;
+    std::thread reader([&] {
+        char buffer[4096];
+        while (received.size() < expected.size())
+        {
+            ssize_t res = ::read(peer, buffer, sizeof(buffer));
+            ASSERT_GT(res, 0);
+            received.append(buffer, res);
+        }
+    });
+    _loop.run();
+    reader.join();
+    socket.detach();
+    EXPECT_EQ(completed, 10000);
+    EXPECT_EQ(received, expected);
+}
+
+TEST_F(MainLoopTest, WriteQueuedBeforeConnectIsSent)
+{
+    Ipv4Listener listener(21469, Listener::DEFAULT_BACKLOG, true);
+    std::string received;
+    std::thread server([&] {
+        TcpStream stream = listener.awaitConnection();
+        received = stream.readLine();
+    });
+    AsyncSocket socket([](const std::string& msg) { FAIL() << msg; });
+    bool connected = false;
+    ASSERT_TRUE(socket.asyncConnect(Ipv4Address::resolve("127.0.0.1", 21469), [&connected] { connected = true; }));
+    socket.asyncWrite("queued\n", [this] { _loop.exit(); });
+    _loop.addObject(socket);
+    _loop.run();
+    server.join();
+    socket.detach();
+    EXPECT_TRUE(connected);
+    EXPECT_EQ(received, "queued");
+}
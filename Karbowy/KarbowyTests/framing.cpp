@@ -0,0 +1,156 @@
+#include <gtest/gtest.h>
+#include "framing.h"
+#include "linebuffer.h"
+#include "task.h"
+#include "protocol.h"
+
+TEST(FramingTest, LogEntryRecordRoundTrip)
+{
+    LogEntry start { LogEntryType_TASK_START, fromEpochMilliseconds(1463260800123), "jkowalski", 42 };
+    LogEntry logout { LogEntryType_LOGOUT, fromEpochMilliseconds(1463260900456), "jkowalski", boost::none };
+    std::string data;
+    appendLogEntryRecord(data, start);
+    appendLogEntryRecord(data, logout);
+
+    boost::string_view view(data);
+    LogEntry entry;
+    ASSERT_TRUE(parseLogEntryRecord(view, entry));
+    EXPECT_EQ(entry._type, LogEntryType_TASK_START);
+    EXPECT_EQ(entry._timestamp, start._timestamp);
+    EXPECT_EQ(entry._userId, "jkowalski");
+    ASSERT_TRUE(entry._taskId);
+    EXPECT_EQ(*entry._taskId, 42);
+    ASSERT_TRUE(parseLogEntryRecord(view, entry));
+    EXPECT_EQ(entry._type, LogEntryType_LOGOUT);
+    EXPECT_EQ(entry._timestamp, logout._timestamp);
+    EXPECT_FALSE(entry._taskId);
+    EXPECT_TRUE(view.empty());
+}
+
+TEST(FramingTest, TruncatedRecordIsRejected)
+{
+    std::string data;
+    appendLogEntryRecord(data, LogEntry { LogEntryType_LOGIN, fromEpochMilliseconds(0), "user", boost::none });
+    boost::string_view view(data.data(), data.size() - 1);
+    LogEntry entry;
+    EXPECT_FALSE(parseLogEntryRecord(view, entry));
+}
+
+TEST(FramingTest, TaskRecordRoundTrip)
+{
+    ClientTask task(7, "Title with \"quotes\"", "first line\nsecond line", std::chrono::seconds(3600));
+    std::string data;
+    appendTaskRecord(data, task);
+
+    boost::string_view view(data);
+    ClientTask parsed;
+    ASSERT_TRUE(parseTaskRecord(view, parsed));
+    EXPECT_EQ(parsed._id, 7);
+    EXPECT_EQ(parsed._title, task._title);
+    EXPECT_EQ(parsed._description, task._description);
+    EXPECT_EQ(parsed._timeSpent, task._timeSpent);
+    EXPECT_TRUE(view.empty());
+}
+
+TEST(FramingTest, FramesInterleavedWithLines)
+{
+    std::string data = "LAST ENTRY AT 2016-05-15 10:00:00.000\n";
+    size_t frameStart = beginFrame(data);
+    data += "payload";
+    endFrame(data, frameStart);
+    appendEmptyFrame(data);
+    data += "RETRIEVE TASKS\n";
+
+    LineBuffer buffer;
+    // data arrives in two parts, split inside header of first frame
+    buffer.addData(data.data(), 42);
+    EXPECT_EQ(buffer.getFirstLine(), "LAST ENTRY AT 2016-05-15 10:00:00.000");
+    EXPECT_FALSE(buffer.hasFullFrame());
+    buffer.addData(data.data() + 42, data.size() - 42);
+    ASSERT_TRUE(buffer.hasFullFrame());
+    EXPECT_EQ(buffer.getFirstFrameView(), "payload");
+    ASSERT_TRUE(buffer.hasFullFrame());
+    EXPECT_TRUE(buffer.getFirstFrameView().empty());
+    ASSERT_TRUE(buffer.hasFullLine());
+    EXPECT_EQ(buffer.getFirstLine(), "RETRIEVE TASKS");
+}
+
+TEST(FramingTest, TaskListDeltaFrames)
+{
+    TaskListDelta delta;
+    delta._version = 17;
+    delta._complete = false;
+    delta._changed.push_back(std::make_unique<ClientTask>(3, "Changed", "description", std::chrono::seconds(60)));
+    delta._removed = { 5, 8 };
+    std::string data = formatTaskListDelta(delta, true);
+
+    LineBuffer buffer;
+    buffer.addData(data.data(), data.size());
+    EXPECT_EQ(buffer.getFirstLine(), "CHANGED TASKS VERSION 17");
+    ASSERT_TRUE(buffer.hasFullFrame());
+    boost::string_view payload = buffer.getFirstFrameView();
+    ClientTask task;
+    ASSERT_TRUE(parseTaskRecord(payload, task));
+    EXPECT_EQ(task._id, 3);
+    EXPECT_TRUE(payload.empty());
+    ASSERT_TRUE(buffer.hasFullFrame());
+    EXPECT_TRUE(buffer.getFirstFrameView().empty());
+    ASSERT_TRUE(buffer.hasFullFrame());
+    payload = buffer.getFirstFrameView();
+    int taskId;
+    ASSERT_TRUE(parseRemovedTaskRecord(payload, taskId));
+    EXPECT_EQ(taskId, 5);
+    ASSERT_TRUE(parseRemovedTaskRecord(payload, taskId));
+    EXPECT_EQ(taskId, 8);
+    EXPECT_TRUE(payload.empty());
+    ASSERT_TRUE(buffer.hasFullFrame());
+    EXPECT_TRUE(buffer.getFirstFrameView().empty());
+}
+
+static std::unique_ptr<ClientTask> makeTask(int id, size_t numOfLines, size_t lineLength)
+{
+    std::string description;
+    for (size_t i = 0; i < numOfLines; ++i)
+    {
+        description += std::string(lineLength, 'x') + '\n';
+    }
+    return std::make_unique<ClientTask>(id, "Task", description, std::chrono::seconds(0));
+}
+
+TEST(FramingTest, LargeTaskRecordsStayWithinMaxFrameSize)
+{
+    std::vector<std::unique_ptr<ClientTask> > tasks;
+    tasks.push_back(makeTask(1, 1, 50000));
+    // doesn't fit into frame together with previous one
+    tasks.push_back(makeTask(2, 20, 50000));
+    tasks.push_back(makeTask(3, 1, 10));
+    std::string data = formatTasksFrames(tasks);
+
+    boost::string_view rest(data);
+    std::vector<int> ids;
+    while (true)
+    {
+        ASSERT_GE(rest.size(), FRAME_HEADER_SIZE);
+        size_t length = parseFrameHeader(rest.data());
+        EXPECT_LE(length, MAX_FRAME_SIZE);
+        rest.remove_prefix(FRAME_HEADER_SIZE);
+        ASSERT_GE(rest.size(), length);
+        if (length == 0)
+        {
+            break;
+        }
+        boost::string_view payload = rest.substr(0, length);
+        rest.remove_prefix(length);
+        ClientTask task;
+        while (! payload.empty())
+        {
+            ASSERT_TRUE(parseTaskRecord(payload, task));
+            ids.push_back(task._id);
+        }
+    }
+    EXPECT_TRUE(rest.empty());
+    EXPECT_EQ(ids, std::vector<int>({ 1, 2, 3 }));
+
+    tasks.push_back(makeTask(4, 25, 50000));
+    EXPECT_THROW(formatTasksFrames(tasks), std::length_error);
+}
@@ -90,3 +90,51 @@ TEST_F(LineBufferTest, SignalEofInTheMiddleOfLine)
     EXPECT_FULL("siała baba mak");
     EXPECT_EOF();
 }
+
+TEST_F(LineBufferTest, DirectReadIntoBuffer)
+{
+    static const char* txt = "siała baba mak\nnie wie";
+    static const size_t len = strlen(txt);
+    char* target = _buffer.prepare(1024);
+    memcpy(target, txt, len);
+    _buffer.commit(len);
+    EXPECT_TRUE(_buffer.hasFullLine());
+    EXPECT_EQ(_buffer.getFirstLineView(), "siała baba mak");
+    EXPECT_EMPTY();
+    target = _buffer.prepare(1024);
+    memcpy(target, "działa jak\n", 12);
+    _buffer.commit(12);
+    EXPECT_FULL("nie wiedziała jak");
+    EXPECT_EMPTY();
+}
+
+TEST_F(LineBufferTest, LinesLongerThanChunk)
+{
+    std::string longLine(100000, 'x');
+    for (size_t i = 0; i < longLine.size(); i += 1000)
+    {
+        _buffer.addData(longLine.data() + i, 1000);
+        EXPECT_EMPTY();
+    }
+    _buffer.addData("\nshort\n", 7);
+    EXPECT_FULL(longLine);
+    EXPECT_FULL("short");
+    EXPECT_EMPTY();
+}
+
+TEST_F(LineBufferTest, ManySmallLines)
+{
+    for (int i = 0; i < 10000; ++i)
+    {
+        std::string line = std::to_string(i) + "\n";
+        _buffer.addData(line.data(), line.size());
+        if (i % 3 == 2)
+        {
+            for (int j = i - 2; j <= i; ++j)
+            {
+                EXPECT_FULL(std::to_string(j));
+            }
+            EXPECT_EMPTY();
+        }
+    }
+}
@@ -0,0 +1,200 @@
+#include <gtest/gtest.h>
+#include "predefinedqueries.h"
+#include "sessionhelpers.h"
+#include "logingestor.h"
+#include "databasewriter.h"
+#include "logprocessor.h"
+#include "logentry.h"
+#include <unistd.h>
+#include <vector>
+
+static const char* dbFileName = "LogStorageTest.db";
+
+// Stores log entries through server's queries, as uploads of StacjaSzefa do.
+class LogStorageTest : public testing::Test
+{
+protected:
+    int _clientId;
+
+    static void removeDatabase()
+    {
+        unlink(dbFileName);
+        unlink((std::string(dbFileName) + "-wal").c_str());
+        unlink((std::string(dbFileName) + "-shm").c_str());
+    }
+
+    void SetUp() override
+    {
+        removeDatabase();
+        initializeDatabase(dbFileName, DatabaseConfig());
+        _clientId = registerClient("6ba7b810-9dad-11d1-80b4-00c04fd430c8");
+    }
+
+    void TearDown() override
+    {
+        shutdownDatabase();
+        removeDatabase();
+    }
+
+    static LogEntry entry(int n)
+    {
+        return LogEntry { LogEntryType_TASK_START, fromEpochMilliseconds(1464000000000 + n), "ybarodzi", n };
+    }
+
+    // entries numbered from first to last, sequence numbers equal to entry numbers
+    void storeSequenced(int first, int last)
+    {
+        std::vector<LogEntry> entries;
+        std::vector<int> sequences;
+        for (int n = first; n <= last; ++n)
+        {
+            entries.push_back(entry(n));
+            sequences.push_back(n);
+        }
+        databaseWriter().execute([&](Database&) { storeLogEntries(_clientId, entries, sequences); });
+    }
+
+    // task ids of stored entries in order of insertion
+    std::vector<int> storedEntries()
+    {
+        auto& query = database().statement<Query<int, int> >("SELECT task FROM Logs WHERE client = ? ORDER BY id");
+        query.execute(_clientId);
+        std::vector<int> tasks;
+        int task;
+        while (query.next(task))
+        {
+            tasks.push_back(task);
+        }
+        return tasks;
+    }
+
+    static std::vector<int> range(int first, int last)
+    {
+        std::vector<int> numbers;
+        for (int n = first; n <= last; ++n)
+        {
+            numbers.push_back(n);
+        }
+        return numbers;
+    }
+};
+
+TEST_F(LogStorageTest, ResentEntriesAreStoredOnce)
+{
+    EXPECT_EQ(findLastSequence(_clientId), 0);
+    storeSequenced(1, 10);
+    EXPECT_EQ(findLastSequence(_clientId), 10);
+    // acknowledgement of 6..10 was lost
+    storeSequenced(6, 15);
+    EXPECT_EQ(findLastSequence(_clientId), 15);
+    EXPECT_EQ(storedEntries(), range(1, 15));
+}
+
+TEST_F(LogStorageTest, FailedJobStoresNothing)
+{
+    storeSequenced(1, 5);
+    std::vector<LogEntry> entries { entry(6), entry(7) };
+    std::vector<int> sequences { 6, 7 };
+    EXPECT_THROW(databaseWriter().execute([&](Database&)
+    {
+        storeLogEntries(_clientId, entries, sequences);
+        throw std::runtime_error("commit failed");
+    }), std::runtime_error);
+    EXPECT_EQ(findLastSequence(_clientId), 5);
+    EXPECT_EQ(storedEntries(), range(1, 5));
+    // entries come again with next upload
+    storeSequenced(6, 7);
+    EXPECT_EQ(storedEntries(), range(1, 7));
+}
+
+TEST_F(LogStorageTest, FirstResumableUploadStartsAfterPlainUpload)
+{
+    boost::optional<Timestamp> lastEntryTime;
+    EXPECT_EQ(findLastSequence(_clientId, lastEntryTime), 0);
+    EXPECT_FALSE(lastEntryTime);
+
+    std::vector<LogEntry> entries { entry(1), entry(2), entry(3) };
+    databaseWriter().execute([&](Database&) { storeLogEntries(_clientId, entries); });
+    EXPECT_EQ(findLastSequence(_clientId, lastEntryTime), 0);
+    ASSERT_TRUE(lastEntryTime);
+    EXPECT_EQ(*lastEntryTime, entry(3)._timestamp);
+
+    // once resumable upload stored something, sequence alone says where to resume
+    storeSequenced(4, 5);
+    EXPECT_EQ(findLastSequence(_clientId, lastEntryTime), 5);
+    EXPECT_FALSE(lastEntryTime);
+    EXPECT_EQ(storedEntries(), range(1, 5));
+}
+
+TEST_F(LogStorageTest, IngestorCommitsBatchesOnce)
+{
+    IngestionConfig config;
+    config._batchSize = 4;
+    {
+        LogIngestor ingestor(_clientId, config);
+        for (int n = 1; n <= 10; ++n)
+        {
+            ingestor.add(n, entry(n));
+        }
+        ingestor.finish();
+        EXPECT_EQ(ingestor.committedSequence(), 10);
+        EXPECT_EQ(ingestor.employeeIds(), std::set<std::string> { "ybarodzi" });
+    }
+    {
+        // connection broke before client got acknowledgement of 8..10
+        LogIngestor ingestor(_clientId, config);
+        for (int n = 8; n <= 20; ++n)
+        {
+            ingestor.add(n, entry(n));
+        }
+        ingestor.finish();
+        EXPECT_EQ(ingestor.committedSequence(), 20);
+    }
+    EXPECT_EQ(findLastSequence(_clientId), 20);
+    EXPECT_EQ(storedEntries(), range(1, 20));
+}
+
+TEST_F(LogStorageTest, WriterSurvivesWritesOfOtherConnections)
+{
+    processLogs("wwisniew");
+    {
+        // e.g. GUI, which writes through its own connection
+        Database other(dbFileName, DatabaseConfig());
+        other.execute("UPDATE Tasks SET title = title");
+    }
+    EXPECT_NO_THROW(registerClient("7d444840-9dc0-11d1-b245-5ffdce74fad2"));
+    EXPECT_NO_THROW(processLogs("wwisniew"));
+    storeSequenced(1, 3);
+    EXPECT_EQ(storedEntries(), range(1, 3));
+}
+
+TEST_F(LogStorageTest, ProcessingLeavesEntriesStoredAfterReadingThem)
+{
+    std::vector<LogEntry> entries { entry(1), entry(2) };
+    databaseWriter().execute([&](Database&) { storeLogEntries(_clientId, entries); });
+    std::string employeeId("ybarodzi");
+    LogProcessor processor(employeeId);
+    processor.checkEmployeeId();
+    processor.loadAssignments();
+    auto& query = findUnprocessedLogEntriesForEmployeeQ();
+    query.execute(employeeId);
+    ServerLogEntry read;
+    while (query.next(read))
+    {
+        processor.process(std::move(read));
+    }
+    // uploaded while results were waiting for writer
+    std::vector<LogEntry> later { entry(3) };
+    databaseWriter().execute([&](Database&) { storeLogEntries(_clientId, later); });
+    databaseWriter().execute([&](Database&) { processor.finish(); });
+
+    auto& unprocessed = database().statement<Query<int, std::string> >("SELECT task FROM Logs WHERE employee = ? AND processed = 0");
+    unprocessed.execute(employeeId);
+    std::vector<int> tasks;
+    int task;
+    while (unprocessed.next(task))
+    {
+        tasks.push_back(task);
+    }
+    EXPECT_EQ(tasks, std::vector<int> { 3 });
+}
@@ -0,0 +1,79 @@
+#include "protocoltest.h"
+#include "task.h"
+
+// several times more than fits in upload window of AsyncClient
+static const int NUM_OF_ENTRIES = 50000;
+
+// Uploads entries with LOG UPLOAD, client formats them in many chunks some of which are
+// written to socket at once, from inside asyncWrite.
+class LogUploadTest : public ProtocolTest
+{
+protected:
+    int _received;
+    bool _finished;
+
+    LogUploadTest() :
+        _received(0),
+        _finished(false) { }
+
+    ServerCallbacks callbacks() override
+    {
+        ServerCallbacks callbacks = ProtocolTest::callbacks();
+        callbacks._lastLogEntryTime = []() { return boost::optional<Timestamp>(); };
+        callbacks._onLogEntry = [this](LogEntry&& entry)
+        {
+            ++_received;
+            EXPECT_EQ(*entry._taskId, _received);
+        };
+        callbacks._onLogsReceived = [](const ServerCallbacks::LogsStoredCallback& onStored) { onStored(std::string()); };
+        callbacks._retrieveTasks = [](bool binaryFraming)
+        {
+            AsyncClient::TasksList tasks;
+            return binaryFraming ? formatTasksFrames(tasks) : formatTasksText(tasks);
+        };
+        return callbacks;
+    }
+
+    void upload(bool binaryFraming, uint16_t port)
+    {
+        run(port, binaryFraming, [this]()
+        {
+            _client->sendLogs([](const boost::optional<Timestamp>& lastEntryTime)
+            {
+                EXPECT_FALSE(lastEntryTime);
+                auto next = std::make_shared<int>(1);
+                return [next](LogEntry& entry)
+                {
+                    if (*next > NUM_OF_ENTRIES)
+                    {
+                        return false;
+                    }
+                    entry = LogEntry { LogEntryType_TASK_START, fromEpochMilliseconds(*next), "user", *next };
+                    ++*next;
+                    return true;
+                };
+            },
+            [this]()
+            {
+                // END LOG sent twice would be rejected as invalid command before this request
+                _client->retrieveTasks([this](AsyncClient::TasksList&&)
+                {
+                    _finished = true;
+                    _loop.exit();
+                });
+            });
+        });
+        EXPECT_TRUE(_finished);
+        EXPECT_EQ(_received, NUM_OF_ENTRIES);
+    }
+};
+
+TEST_F(LogUploadTest, ManyChunksInTextFraming)
+{
+    upload(false, 21462);
+}
+
+TEST_F(LogUploadTest, ManyChunksInBinaryFraming)
+{
+    upload(true, 21463);
+}
@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+#include "protocol.h"
+#include "parse.h"
+
+TEST(ParseTest, LogEntryVerbs)
+{
+    LogEntry entry;
+    ASSERT_TRUE(parseLogEntry("2016-05-15 10:20:30.456 wwisniew LOGIN", entry));
+    EXPECT_EQ(entry._type, LogEntryType_LOGIN);
+    EXPECT_EQ(entry._userId, "wwisniew");
+    EXPECT_FALSE(entry._taskId);
+    EXPECT_EQ(formatTimestamp(entry._timestamp), "2016-05-15 10:20:30.456");
+
+    ASSERT_TRUE(parseLogEntry("2016-05-15 10:20:31.000 wwisniew LOGOUT", entry));
+    EXPECT_EQ(entry._type, LogEntryType_LOGOUT);
+    EXPECT_FALSE(entry._taskId);
+
+    const std::pair<const char*, LogEntryType> taskVerbs[] = {
+        { "START", LogEntryType_TASK_START },
+        { "PAUSE", LogEntryType_TASK_PAUSE },
+        { "FINISH", LogEntryType_TASK_FINISH }
+    };
+    for (const auto& verb : taskVerbs)
+    {
+        ASSERT_TRUE(parseLogEntry(std::string("2016-05-15 10:20:32.000 wwisniew TASK 42 ") + verb.first, entry));
+        EXPECT_EQ(entry._type, verb.second);
+        ASSERT_TRUE(entry._taskId);
+        EXPECT_EQ(*entry._taskId, 42);
+    }
+}
+
+TEST(ParseTest, InvalidLogEntries)
+{
+    LogEntry entry;
+    EXPECT_FALSE(parseLogEntry("2016-05-15 10:20:30.456 wwisniew LOGINX", entry));
+    EXPECT_FALSE(parseLogEntry("2016-05-15 10:20:30.456 wwisniew LOG", entry));
+    EXPECT_FALSE(parseLogEntry("2016-05-15 10:20:30.456 wwisniew TASK START", entry));
+    EXPECT_FALSE(parseLogEntry("2016-05-15 10:20:30.456 wwisniew TASK 42 STOP", entry));
+    EXPECT_FALSE(parseLogEntry("2016-05-15 10:20:30.456 wwisniew TASK 42 START ", entry));
+    EXPECT_FALSE(parseLogEntry("2016-05-15 10:20 wwisniew LOGIN", entry));
+    EXPECT_FALSE(parseLogEntry("", entry));
+}
+
+TEST(ParseTest, QuotedStringRoundTrip)
+{
+    const std::string original = "say \"hi\" \\ bye";
+    std::string parsed = "previous value";
+    int id;
+    ASSERT_TRUE(parse("TASK 7 TITLE " + quoteString(original), "TASK ", IntToken(id), " TITLE ", QuotedStringToken(parsed)));
+    EXPECT_EQ(id, 7);
+    EXPECT_EQ(parsed, original);
+
+    EXPECT_FALSE(parse("\"unterminated \\\"", QuotedStringToken(parsed)));
+    EXPECT_EQ(parsed, original);
+}
@@ -0,0 +1,69 @@
+#include "protocoltest.h"
+#include "task.h"
+
+ProtocolTest::ProtocolTest() :
+    _serverUuid("server-uuid") { }
+
+void ProtocolTest::SetUp()
+{
+    _loop.addObject(_queue);
+    _loop.start();
+}
+
+void ProtocolTest::TearDown()
+{
+    _loop.removeAllObjects();
+}
+
+ServerCallbacks ProtocolTest::callbacks()
+{
+    ServerCallbacks callbacks;
+    callbacks._findPassword = [](const std::string&) { return boost::make_optional(std::string("password")); };
+    callbacks._onLogin = [](const std::string&, const std::string&, const ServerCallbacks::LoginDoneCallback& onDone)
+    {
+        onDone(std::string());
+    };
+    return callbacks;
+}
+
+void ProtocolTest::onServerError(const std::string& msg)
+{
+    onError(msg);
+}
+
+void ProtocolTest::onClientError(const std::string& msg)
+{
+    onError(msg);
+}
+
+void ProtocolTest::onError(const std::string& msg)
+{
+    _error = msg;
+    _loop.exit();
+}
+
+void ProtocolTest::acceptConnection(Descriptor&& fd)
+{
+    _server = std::make_unique<AsyncServerConnection>(_loop, std::move(fd), _serverUuid, true, callbacks(),
+                                                      std::bind(&ProtocolTest::onServerError, this, std::placeholders::_1));
+    _server->start();
+}
+
+void ProtocolTest::run(uint16_t port, bool binaryFraming, const std::function<void()>& start)
+{
+    // connections closed by server leave port in TIME_WAIT, reused port lets test run again at once
+    Ipv4Listener listener(port, Listener::DEFAULT_BACKLOG, true);
+    AsyncListener asyncListener(listener,
+                                std::bind(&ProtocolTest::acceptConnection, this, std::placeholders::_1),
+                                std::bind(&ProtocolTest::onError, this, std::placeholders::_1));
+    _loop.addObject(asyncListener);
+    ClientConfig config { "6ba7b810-9dad-11d1-80b4-00c04fd430c8", _serverUuid, "127.0.0.1", port, "user", "password", false, binaryFraming };
+    _client = std::make_unique<AsyncClient>(_loop, config, std::bind(&ProtocolTest::onClientError, this, std::placeholders::_1), []() { });
+    start();
+    _loop.run();
+    _loop.removeAllObjects();
+    _client.reset();
+    _server.reset();
+
+    EXPECT_EQ(_error, std::string());
+}
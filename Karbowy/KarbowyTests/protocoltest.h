@@ -0,0 +1,41 @@
+#ifndef PROTOCOLTEST_H
+#define PROTOCOLTEST_H
+
+#include <gtest/gtest.h>
+#include "protocol.h"
+#include "eventdispatcher.h"
+#include <functional>
+#include <memory>
+#include <string>
+
+// Runs AsyncClient against AsyncServerConnection accepted on loopback listener.
+class ProtocolTest : public testing::Test
+{
+protected:
+    MainLoop _loop;
+    TaskQueue _queue;
+    std::string _serverUuid;
+    std::unique_ptr<AsyncServerConnection> _server;
+    std::unique_ptr<AsyncClient> _client;
+    std::string _error;
+
+    ProtocolTest();
+
+    void SetUp() override;
+    void TearDown() override;
+
+    // callbacks of accepted connection, by default only log in every user with password "password"
+    virtual ServerCallbacks callbacks();
+    // by default both errors end the test with _error set
+    virtual void onServerError(const std::string& msg);
+    virtual void onClientError(const std::string& msg);
+    void onError(const std::string& msg);
+
+    // creates _client with given framing and runs exchange started by given function until _loop.exit()
+    void run(uint16_t port, bool binaryFraming, const std::function<void()>& start);
+
+private:
+    void acceptConnection(Descriptor&& fd);
+};
+
+#endif // PROTOCOLTEST_H
@@ -0,0 +1,193 @@
+#include "protocoltest.h"
+#include "task.h"
+#include <random>
+#include <vector>
+
+static const int NUM_OF_ENTRIES = 2000;
+static const size_t BATCH_SIZE = 16;
+static const int MAX_ENTRIES_BEFORE_DROP = 200;
+static const int MAX_ATTEMPTS = 1000;
+
+// Uploads entries with LOG UPLOAD RESUMABLE to server that drops connection at random points
+// and checks that every entry ends up stored exactly once.
+class ResumableUploadTest : public ProtocolTest
+{
+protected:
+    std::mt19937 _random;
+
+    // "database" of the server
+    std::vector<int> _stored;
+    int _storedSequence;
+    // entries up to this one were stored by plain LOG UPLOAD, 0 if none
+    int _storedByPlainUpload;
+    // entries of current connection waiting for commit
+    std::vector<int> _batch;
+    int _entriesUntilDrop;
+
+    std::vector<int> _acks;
+    int _attempts;
+    bool _finished;
+
+    ResumableUploadTest() :
+        _random(12345),
+        _storedSequence(0),
+        _storedByPlainUpload(0),
+        _entriesUntilDrop(0),
+        _attempts(0),
+        _finished(false) { }
+
+    bool chance(int percent)
+    {
+        return std::uniform_int_distribution<int>(1, 100)(_random) <= percent;
+    }
+
+    static Timestamp entryTime(int n)
+    {
+        return fromEpochMilliseconds(n);
+    }
+
+    void commit()
+    {
+        for (int sequence : _batch)
+        {
+            // entries stored before connection broke come again if their ACK was lost
+            if (sequence > _storedSequence)
+            {
+                _stored.push_back(sequence);
+                _storedSequence = sequence;
+            }
+        }
+        _batch.clear();
+    }
+
+    ServerCallbacks callbacks() override
+    {
+        ServerCallbacks callbacks = ProtocolTest::callbacks();
+        callbacks._lastSequence = [this](boost::optional<Timestamp>& lastEntryTime)
+        {
+            if (chance(5))
+            {
+                throw std::runtime_error("dropped before upload");
+            }
+            _batch.clear();
+            _entriesUntilDrop = std::uniform_int_distribution<int>(1, MAX_ENTRIES_BEFORE_DROP)(_random);
+            if (_storedSequence == 0 && _storedByPlainUpload > 0)
+            {
+                lastEntryTime = entryTime(_storedByPlainUpload);
+            }
+            return _storedSequence;
+        };
+        callbacks._onSequencedLogEntry = [this](int sequence, LogEntry&& entry)
+        {
+            EXPECT_EQ(*entry._taskId, sequence);
+            _batch.push_back(sequence);
+            if (_batch.size() >= BATCH_SIZE)
+            {
+                commit();
+            }
+            // uncommitted entries are lost, committed ones may be not acknowledged yet
+            if (--_entriesUntilDrop == 0)
+            {
+                throw std::runtime_error("dropped during upload");
+            }
+        };
+        callbacks._committedSequence = [this]() { return _storedSequence; };
+        callbacks._onLogsReceived = [this](const ServerCallbacks::LogsStoredCallback& onStored)
+        {
+            commit();
+            onStored(std::string());
+        };
+        return callbacks;
+    }
+
+    void onServerError(const std::string&) override
+    {
+        // connection can't be destroyed from its own handler
+        _queue.addTask([this]() { _server.reset(); });
+    }
+
+    void onClientError(const std::string&) override
+    {
+        if (_attempts >= MAX_ATTEMPTS)
+        {
+            _loop.exit();
+            return;
+        }
+        _queue.addTask([this]() { resume(); });
+    }
+
+    // sends entries server hasn't stored yet
+    void resume()
+    {
+        ++_attempts;
+        _client->sendLogsResumable([this](int lastSequence, const boost::optional<Timestamp>& lastEntryTime)
+        {
+            auto next = std::make_shared<int>(lastSequence + 1);
+            if (lastEntryTime)
+            {
+                EXPECT_EQ(lastSequence, 0);
+                // the workstation selects entries by time here
+                while (*next <= NUM_OF_ENTRIES && entryTime(*next) <= *lastEntryTime)
+                {
+                    ++*next;
+                }
+            }
+            return [next](int& sequence, LogEntry& entry)
+            {
+                if (*next > NUM_OF_ENTRIES)
+                {
+                    return false;
+                }
+                sequence = *next;
+                entry = LogEntry { LogEntryType_TASK_START, entryTime(*next), "user", *next };
+                ++*next;
+                return true;
+            };
+        },
+        [this](int sequence)
+        {
+            if (! _acks.empty())
+            {
+                EXPECT_GE(sequence, _acks.back());
+            }
+            // server never acknowledges entries it hasn't stored
+            EXPECT_LE(sequence, _storedSequence);
+            _acks.push_back(sequence);
+        },
+        [this]()
+        {
+            _finished = true;
+            _loop.exit();
+        });
+    }
+
+    void upload(bool binaryFraming, uint16_t port)
+    {
+        run(port, binaryFraming, [this]() { resume(); });
+        ASSERT_TRUE(_finished);
+        EXPECT_GT(_attempts, 1);
+        ASSERT_EQ(_stored.size(), static_cast<size_t>(NUM_OF_ENTRIES - _storedByPlainUpload));
+        for (size_t i = 0; i < _stored.size(); ++i)
+        {
+            ASSERT_EQ(_stored[i], _storedByPlainUpload + 1 + static_cast<int>(i));
+        }
+        ASSERT_FALSE(_acks.empty());
+        EXPECT_EQ(_acks.back(), NUM_OF_ENTRIES);
+    }
+};
+
+TEST_F(ResumableUploadTest, DroppedConnectionsInTextFraming)
+{
+    upload(false, 21460);
+}
+
+TEST_F(ResumableUploadTest, DroppedConnectionsInBinaryFraming)
+{
+    upload(true, 21461);
+}
+
+TEST_F(ResumableUploadTest, FirstUploadSkipsEntriesOfPlainUpload)
+{
+    _storedByPlainUpload = NUM_OF_ENTRIES / 4;
+    upload(false, 21466);
+}
@@ -42,3 +42,34 @@ TEST(SocketTest, ConnectingByIpv4)
     client.join();
     EXPECT_EQ(error,"");
 }
+
+TEST(SocketTest, ListenersSharingPort)
+{
+    Ipv4Listener first(21457, Listener::DEFAULT_BACKLOG, true);
+    Ipv4Listener second(21457, Listener::DEFAULT_BACKLOG, true);
+    EXPECT_NE(first.descriptor(), second.descriptor());
+    EXPECT_THROW(Ipv4Listener(21457), std::exception);
+}
+
+TEST(SocketTest, BufferedStreamFlushesBeforeRead)
+{
+    Ipv4Listener listener(21458);
+    std::string received;
+    std::thread client([&received] {
+        TcpStream stream = TcpStream::connect(Ipv4Address::resolve("localhost", 21458));
+        for (int i = 0; i < 3; ++i)
+        {
+            received += stream.readLine();
+        }
+        stream.writeLine("DONE\n");
+    });
+    TcpStream stream = listener.awaitConnection();
+    stream.setBuffered();
+    stream.setReadChunkSize(16);
+    stream.writeLine("A\n");
+    stream.writeLine("B\n");
+    stream.writeLine("C\n");
+    EXPECT_EQ(stream.readLine(), "DONE");
+    client.join();
+    EXPECT_EQ(received, "ABC");
+}
@@ -0,0 +1,63 @@
+#include "protocoltest.h"
+#include "task.h"
+
+// lines of list arrive in few large reads, so most of them are already buffered when read
+static const int NUM_OF_TASKS = 50000;
+
+// Retrieves task list with RETRIEVE TASKS from AsyncServerConnection in text framing.
+class TaskRetrievalTest : public ProtocolTest
+{
+protected:
+    ServerCallbacks callbacks() override
+    {
+        ServerCallbacks callbacks = ProtocolTest::callbacks();
+        callbacks._retrieveTasks = [](bool)
+        {
+            AsyncClient::TasksList tasks;
+            for (int i = 1; i <= NUM_OF_TASKS; ++i)
+            {
+                tasks.emplace_back(std::make_unique<ClientTask>(i, "title", "first line\nsecond line", std::chrono::seconds(i)));
+            }
+            return formatTasksText(tasks);
+        };
+        return callbacks;
+    }
+};
+
+TEST_F(TaskRetrievalTest, LongListInTextFraming)
+{
+    size_t received = 0;
+    run(21464, false, [&]()
+    {
+        _client->retrieveTasks([&](AsyncClient::TasksList&& tasks)
+        {
+            received = tasks.size();
+            ASSERT_FALSE(tasks.empty());
+            EXPECT_EQ(tasks.back()->_id, NUM_OF_TASKS);
+            EXPECT_EQ(tasks.back()->_description.size(), 2u);
+            _loop.exit();
+        });
+    });
+    EXPECT_EQ(received, static_cast<size_t>(NUM_OF_TASKS));
+}
+
+TEST_F(TaskRetrievalTest, EachRetrievalStartsFromEmptyList)
+{
+    std::vector<size_t> received;
+    run(21465, false, [&]()
+    {
+        // hook doesn't take over the list
+        _client->retrieveTasks([&](AsyncClient::TasksList&& tasks)
+        {
+            received.push_back(tasks.size());
+            _client->retrieveTasks([&](AsyncClient::TasksList&& tasks)
+            {
+                received.push_back(tasks.size());
+                _loop.exit();
+            });
+        });
+    });
+    ASSERT_EQ(received.size(), 2u);
+    EXPECT_EQ(received[0], static_cast<size_t>(NUM_OF_TASKS));
+    EXPECT_EQ(received[1], static_cast<size_t>(NUM_OF_TASKS));
+}
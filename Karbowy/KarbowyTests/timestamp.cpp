@@ -0,0 +1,48 @@
+#include <gtest/gtest.h>
+#include "timestamp.h"
+#include <time.h>
+#include <stdio.h>
+
+static std::string formatWithGmtime(int64_t millis)
+{
+    time_t time = millis / 1000;
+    tm t;
+    gmtime_r(&time, &t);
+    // fields are ints, compiler checks room for widest ones (11 characters each)
+    char buffer[7 * 11 + 6 + 1];
+    snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d %02d:%02d:%02d.%03d",
+             t.tm_year + 1900, t.tm_mon + 1, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, static_cast<int>(millis % 1000));
+    return buffer;
+}
+
+TEST(TimestampTest, FormatMatchesGmtime)
+{
+    // about every 17 hours over 60 years, crosses month ends and leap days
+    for (int64_t millis = 0; millis < 60LL * 365 * 24 * 3600 * 1000; millis += 61200123)
+    {
+        ASSERT_EQ(formatTimestamp(fromEpochMilliseconds(millis)), formatWithGmtime(millis));
+    }
+}
+
+TEST(TimestampTest, ParseIsInverseOfFormat)
+{
+    for (int64_t millis = 0; millis < 60LL * 365 * 24 * 3600 * 1000; millis += 61200123)
+    {
+        Timestamp timestamp;
+        ASSERT_TRUE(parseTimestamp(formatTimestamp(fromEpochMilliseconds(millis)).c_str(), timestamp));
+        ASSERT_EQ(toEpochMilliseconds(timestamp), millis);
+    }
+}
+
+TEST(TimestampTest, InvalidDates)
+{
+    Timestamp timestamp;
+    EXPECT_TRUE(parseTimestamp("2016-02-29 23:59:59.999", timestamp));
+    EXPECT_FALSE(parseTimestamp("2015-02-29 10:00:00.000", timestamp));
+    EXPECT_FALSE(parseTimestamp("2016-13-01 10:00:00.000", timestamp));
+    EXPECT_FALSE(parseTimestamp("2016-04-31 10:00:00.000", timestamp));
+    EXPECT_FALSE(parseTimestamp("2016-04-30 24:00:00.000", timestamp));
+    EXPECT_FALSE(parseTimestamp("2016-04-30 10:60:00.000", timestamp));
+    EXPECT_FALSE(parseTimestamp("2016-04-30 10:00:00,000", timestamp));
+    EXPECT_FALSE(parseTimestamp("2016-04-30T10:00:00.000", timestamp));
+}
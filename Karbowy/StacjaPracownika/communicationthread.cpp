@@ -4,6 +4,8 @@
 #include "task.h"
 #include "predefinedqueries.h"
 #include <functional>
+#include <memory>
+#include <set>
 #include <iostream>
 
 using namespace std::placeholders;
@@ -78,73 +80,147 @@ void CommunicationThread::loginOnCommThread(ClientConfig config)
 
 void CommunicationThread::onConnectSuccess()
 {
-    auto& findUserId = findUserIdByLoginQ();
-    findUserId.execute(_config._userId);
-    if (! findUserId.next(_userId))
+    // exception thrown from client's callback would stop communication thread
+    try
     {
-        auto& insertUser = insertUserC();
-        insertUser.execute(_config._userId);
+        auto& findUserId = findUserIdByLoginQ();
         findUserId.execute(_config._userId);
-        bool res = findUserId.next(_userId);
-        assert(res);
+        if (! findUserId.next(_userId))
+        {
+            auto& insertUser = insertUserC();
+            insertUser.execute(_config._userId);
+            findUserId.execute(_config._userId);
+            bool res = findUserId.next(_userId);
+            assert(res);
+        }
+        // query stopped at its row would keep snapshot of database, so that later transactions
+        // of this connection couldn't write after GUI did
+        findUserId.reset();
+    }
+    catch (std::exception& ex)
+    {
+        emit error(QString("Can't find employee: %1").arg(ex.what()));
+        return;
     }
     emit loggedIn(_userId);
 }
 
 void CommunicationThread::retrieveTasksOnCommThread()
 {
-    _client.retrieveTasks(std::bind(&CommunicationThread::onTasksRetrieved, this, _1));
+    // employee may be not yet connected and have no id, so version is looked up by login;
+    // unknown employee gets all tasks
+    int version;
+    try
+    {
+        auto& findTasksVersion = findTasksVersionQ();
+        findTasksVersion.execute(_config._userId);
+        if (! findTasksVersion.next(version))
+        {
+            version = 0;
+        }
+        while (findTasksVersion.next(version)) { }
+    }
+    catch (std::exception& ex)
+    {
+        emit error(QString("Can't retrieve tasks: %1").arg(ex.what()));
+        return;
+    }
+    _client.retrieveTaskChanges(version, std::bind(&CommunicationThread::onTaskChangesRetrieved, this, _1));
 }
 
-void CommunicationThread::onTasksRetrieved(std::vector<std::unique_ptr<ClientTask> >&& tasks)
+void CommunicationThread::onTaskChangesRetrieved(TaskListDelta&& delta)
 {
-    for (const auto& task : tasks)
+    try
+    {
+        storeTaskChanges(delta);
+    }
+    catch (std::exception& ex)
     {
-        std::cout << "TASK " << task->_id << " TITLE " << quoteString(task->_title) << " SPENT " << toSeconds(task->_timeSpent) << std::endl;
-        for (const auto& line : task->_description)
+        emit error(QString("Can't store tasks: %1").arg(ex.what()));
+        return;
+    }
+    if (delta._complete || ! delta._changed.empty() || ! delta._removed.empty())
+    {
+        emit tasksRetrieved();
+    }
+}
+
+void CommunicationThread::storeTaskChanges(const TaskListDelta& delta)
+{
+    Transaction transaction(communicationDatabase(), TransactionType_IMMEDIATE);
+    // complete list replaces employee's tasks, but those still assigned keep their local state
+    std::set<int> notAssigned;
+    if (delta._complete)
+    {
+        auto& findTaskIds = findTaskIdsForEmployeeQ();
+        findTaskIds.execute(_userId);
+        int taskId;
+        while (findTaskIds.next(taskId))
         {
-            std::cout << line << std::endl;
+            notAssigned.insert(taskId);
         }
-        std::cout << std::endl;
     }
-    std::cout << "END TASKS" << std::endl;
-
-    auto& deleteTaskAssociations = deleteTaskAssociationsForUserC();
-    deleteTaskAssociations.execute(_userId);
     auto& insertTask = insertTaskC();
+    auto& updateAssociation = updateTaskAssociationC();
     auto& insertAssociation = insertTaskAssociationC();
-    for (const auto& task : tasks)
+    for (const auto& task : delta._changed)
     {
         insertTask.execute(task->_id, task->_title, boost::join(task->_description, "\n"));
+        updateAssociation.execute(task->_timeSpent, _userId, task->_id);
         insertAssociation.execute(_userId, task->_id, task->_timeSpent);
+        notAssigned.erase(task->_id);
+    }
+    auto& deleteAssociation = deleteTaskAssociationC();
+    for (int taskId : delta._removed)
+    {
+        deleteAssociation.execute(_userId, taskId);
     }
-    emit tasksRetrieved();
+    for (int taskId : notAssigned)
+    {
+        deleteAssociation.execute(_userId, taskId);
+    }
+    auto& updateTasksVersion = updateTasksVersionC();
+    updateTasksVersion.execute(delta._version, _config._userId);
+    transaction.commit();
 }
 
-static AsyncClient::LogEntryList retrieveLogs(const boost::optional<Timestamp>& lastSeenTimestamp)
+template <typename Param>
+static AsyncClient::SequencedLogCursor makeCursor(Query<SequencedLogEntry, Param>& query)
 {
-    AsyncClient::LogEntryList lst;
-    if (lastSeenTimestamp)
+    // cursor of abandoned upload is released before its last row, query would keep
+    // snapshot of database and transactions of this connection couldn't write
+    std::shared_ptr<QueryBase> resetOnRelease(&query, [](QueryBase* released) { released->reset(); });
+    return [&query, resetOnRelease](int& sequence, LogEntry& entry)
     {
-        auto& query = findLogsNewerThanQ();
-        query.execute(*lastSeenTimestamp);
-        LogEntry entry;
-        while (query.next(entry))
+        SequencedLogEntry row;
+        if (! query.next(row))
         {
-            lst.push_back(entry);
+            return false;
         }
-    }
-    else
+        sequence = row._sequence;
+        entry = std::move(row._entry);
+        return true;
+    };
+}
+
+// rows are stepped one by one while upload progresses, whole backlog is never held in memory
+static AsyncClient::SequencedLogCursor retrieveLogs(int lastSequence, const boost::optional<Timestamp>& lastEntryTime)
+{
+    // server hasn't stored anything by resumable upload yet, but may have entries from LOG UPLOAD
+    if (lastEntryTime)
     {
-        auto& query = findAllLogsQ();
-        query.execute();
-        LogEntry entry;
-        while (query.next(entry))
-        {
-            lst.push_back(entry);
-        }
+        auto& query = findLogsNewerThanQ();
+        query.execute(*lastEntryTime);
+        return makeCursor(query);
     }
-    return lst;
+    auto& query = findLogsAfterSequenceQ();
+    query.execute(lastSequence);
+    return makeCursor(query);
+}
+
+static void onLogsAcknowledged(int sequence)
+{
+    std::cout << "LOGS ACKNOWLEDGED UP TO " << sequence << '\n';
 }
 
 static void onLogsSent()
@@ -152,9 +228,10 @@ static void onLogsSent()
     std::cout << "LOGS SENT\n";
 }
 
+// if connection breaks, next upload resumes after last entry stored by server
 void CommunicationThread::sendLogsOnCommThread()
 {
-    _client.sendLogs(retrieveLogs, onLogsSent);
+    _client.sendLogsResumable(retrieveLogs, onLogsAcknowledged, onLogsSent);
 }
 
 void CommunicationThread::enqueueIfNotBusy(const std::function<void ()> &task, const char *busyMsg)
@@ -38,7 +38,8 @@ private:
     void loginOnCommThread(ClientConfig config);
     void onConnectSuccess();
     void retrieveTasksOnCommThread();
-    void onTasksRetrieved(std::vector<std::unique_ptr<ClientTask> >&& tasks);
+    void onTaskChangesRetrieved(TaskListDelta&& delta);
+    void storeTaskChanges(const TaskListDelta& delta);
     void sendLogsOnCommThread();
     void enqueueIfNotBusy(const std::function<void()>& task, const char* busyMsg);
 };
@@ -121,6 +121,7 @@ std::unique_ptr<ClientConfig> LoginDialog::retrieveResults()
         res->_userId = _ui->userNameEdit->text().toStdString();
         res->_password = _ui->passwordEdit->text().toStdString();
         res->_useIpv6 = _ui->ipv6Button->isChecked();
+        res->_binaryFraming = true;
         return res;
     }
     else
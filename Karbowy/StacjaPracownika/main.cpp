@@ -50,7 +50,12 @@ int main(int argc, char *argv[])
         initializeDatabase();
         auto& retrieveUuid = retrieveUuidQ();
         retrieveUuid.execute();
-        if (! retrieveUuid.next(myUuid))
+        if (retrieveUuid.next(myUuid))
+        {
+            // otherwise GUI's reads would keep seeing database as of now, without tasks retrieved later
+            retrieveUuid.reset();
+        }
+        else
         {
             myUuid = boost::lexical_cast<std::string>(boost::uuids::random_generator()());
             auto& insertUuid = insertUuidC();
@@ -36,6 +36,13 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
+void MainWindow::closeEvent(QCloseEvent* event)
+{
+    // stores time spent on running tasks and closes them in the log
+    _model->pauseAllWork();
+    QMainWindow::closeEvent(event);
+}
+
 void MainWindow::showLoginDialog()
 {
     LoginDialog dialog(_myUuid, _config.get(), this);
@@ -20,6 +20,9 @@ public:
     explicit MainWindow(std::string&& myUuid, CommunicationThread& commThread, QWidget *parent = 0);
     ~MainWindow();
 
+protected:
+    void closeEvent(QCloseEvent* event) override;
+
 private:
     Ui::MainWindow *ui;
     std::string _myUuid;
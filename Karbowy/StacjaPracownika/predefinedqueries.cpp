@@ -3,6 +3,8 @@
 #include <vector>
 
 static Database *db = nullptr;
+// used by communication thread, so that its transactions don't take in writes of GUI thread
+static Database *commDb = nullptr;
 static std::vector<QueryBase*> queries;
 
 static const char* createEmployeesTable =
@@ -28,7 +30,7 @@ static const char* createLogsTable =
 "CREATE TABLE IF NOT EXISTS Logs (\n"
 "  type INTEGER NOT NULL,\n"
 "  employee REFERENCES Employees(id),\n"
-"  timestamp DATETIME NOT NULL,\n"
+"  timestamp INTEGER NOT NULL,\n"
 "  task INTEGER)\n";
 
 static const char* createUuidTable =
@@ -43,16 +45,41 @@ static const char *commands[] = {
     createUuidTable,
 };
 
+// Schema changes applied to databases created by earlier versions, append only.
+static const char* migrations[] = {
+    // 1: timestamps stored as milliseconds since epoch instead of text
+    "UPDATE Logs SET timestamp = CAST(strftime('%s', timestamp) AS INTEGER) * 1000 + CAST(substr(timestamp, 21, 3) AS INTEGER)\n"
+    "WHERE typeof(timestamp) = 'text';\n",
+    // 2: moment up to which time_spent is valid, used for crash recovery
+    "ALTER TABLE EmployeesTasks ADD COLUMN checkpoint INTEGER;\n",
+    // 3: version of server's task data for incremental task list refresh
+    "ALTER TABLE Employees ADD COLUMN tasks_version INTEGER NOT NULL DEFAULT 0;\n",
+    // 4: explicit sequence number of entry for resumable upload, implicit rowid may be renumbered by VACUUM;
+    //    it continues rowids, which were used before, so server's last stored sequence stays valid
+    "CREATE TABLE LogsWithSequence (\n"
+    "  seq INTEGER PRIMARY KEY AUTOINCREMENT,\n"
+    "  type INTEGER NOT NULL,\n"
+    "  employee REFERENCES Employees(id),\n"
+    "  timestamp INTEGER NOT NULL,\n"
+    "  task INTEGER);\n"
+    "INSERT INTO LogsWithSequence(seq, type, employee, timestamp, task)\n"
+    "SELECT rowid, type, employee, timestamp, task FROM Logs;\n"
+    "DROP TABLE Logs;\n"
+    "ALTER TABLE LogsWithSequence RENAME TO Logs;\n"
+};
+
 void initializeDatabase()
 {
     static const char *dbFileName = "StacjaPracownika.db";
 
-    db = new Database(dbFileName);
+    db = new Database(dbFileName, DatabaseConfig());
     for (const char* txt : commands)
     {
         Command<> cmd(*db, txt);
         cmd.execute();
     }
+    migrateDatabase(*db, migrations, sizeof(migrations) / sizeof(migrations[0]));
+    commDb = new Database(dbFileName, DatabaseConfig());
 }
 
 void shutdownDatabase()
@@ -62,10 +89,24 @@ void shutdownDatabase()
         delete query;
     }
     queries.clear();
+    delete commDb;
+    commDb = nullptr;
     delete db;
     db = nullptr;
 }
 
+Database& database()
+{
+    assert(db);
+    return *db;
+}
+
+Database& communicationDatabase()
+{
+    assert(commDb);
+    return *commDb;
+}
+
 Query<std::string>&
 retrieveUuidQ()
 {
@@ -102,7 +143,7 @@ findUserIdByLoginQ()
 
     if (! query)
     {
-        query = new Query<int, std::string>(*db, txt);
+        query = new Query<int, std::string>(*commDb, txt);
         queries.push_back(query);
     }
     return *query;
@@ -116,21 +157,63 @@ insertUserC()
 
     if (! command)
     {
-        command = new Command<std::string>(*db, txt);
+        command = new Command<std::string>(*commDb, txt);
+        queries.push_back(command);
+    }
+    return *command;
+}
+
+Query<int, std::string>&
+findTasksVersionQ()
+{
+    static const char* txt = "SELECT tasks_version FROM Employees WHERE login = ?";
+    static Query<int, std::string> *query = nullptr;
+
+    if (! query)
+    {
+        query = new Query<int, std::string>(*commDb, txt);
+        queries.push_back(query);
+    }
+    return *query;
+}
+
+Command<int, std::string>&
+updateTasksVersionC()
+{
+    static const char* txt = "UPDATE Employees SET tasks_version = ? WHERE login = ?";
+    static Command<int, std::string> *command = nullptr;
+
+    if (! command)
+    {
+        command = new Command<int, std::string>(*commDb, txt);
         queries.push_back(command);
     }
     return *command;
 }
 
-Command<int>&
-deleteTaskAssociationsForUserC()
+Query<int, int>&
+findTaskIdsForEmployeeQ()
+{
+    static const char* txt = "SELECT task FROM EmployeesTasks WHERE employee = ?";
+    static Query<int, int>* query = nullptr;
+
+    if (! query)
+    {
+        query = new Query<int, int>(*commDb, txt);
+        queries.push_back(query);
+    }
+    return *query;
+}
+
+Command<int, int>&
+deleteTaskAssociationC()
 {
-    static const char* txt = "DELETE FROM EmployeesTasks WHERE employee = ?";
-    static Command<int>* query = nullptr;
+    static const char* txt = "DELETE FROM EmployeesTasks WHERE employee = ? AND task = ?";
+    static Command<int, int>* query = nullptr;
 
     if (! query)
     {
-        query = new Command<int>(*db, txt);
+        query = new Command<int, int>(*commDb, txt);
         queries.push_back(query);
     }
     return *query;
@@ -145,7 +228,23 @@ insertTaskC()
 
     if (! query)
     {
-        query = new Command<int, std::string, std::string>(*db, txt);
+        query = new Command<int, std::string, std::string>(*commDb, txt);
+        queries.push_back(query);
+    }
+    return *query;
+}
+
+Command<Duration, int, int>&
+updateTaskAssociationC()
+{
+    // checkpoint and finished are kept, they are known only to this station
+    static const char* txt = "UPDATE EmployeesTasks SET time_spent = ?\n"
+                             "WHERE employee = ? AND task = ?\n";
+    static Command<Duration, int, int>* query = nullptr;
+
+    if (! query)
+    {
+        query = new Command<Duration, int, int>(*commDb, txt);
         queries.push_back(query);
     }
     return *query;
@@ -154,13 +253,14 @@ insertTaskC()
 Command<int, int, Duration>&
 insertTaskAssociationC()
 {
-    static const char* txt = "INSERT INTO EmployeesTasks(employee, task, time_spent)\n"
+    // existing association is left to updateTaskAssociationC
+    static const char* txt = "INSERT OR IGNORE INTO EmployeesTasks(employee, task, time_spent)\n"
                              "VALUES (?, ?, ?)\n";
     static Command<int, int, Duration>* query = nullptr;
 
     if (! query)
     {
-        query = new Command<int, int, Duration>(*db, txt);
+        query = new Command<int, int, Duration>(*commDb, txt);
         queries.push_back(query);
     }
     return *query;
@@ -199,59 +299,100 @@ insertLogEntryC()
     return *query;
 }
 
-Command<Duration, bool, int, int>&
+Command<Duration, Timestamp, bool, int, int>&
 updateTimeSpentOnTaskC()
 {
     static const char *txt = "UPDATE EmployeesTasks\n"
-                             "SET time_spent = ?, finished = ?\n"
+                             "SET time_spent = ?, checkpoint = ?, finished = ?\n"
                              "WHERE employee = ? AND task = ?\n";
-    static Command<Duration, bool, int , int>* query = nullptr;
+    static Command<Duration, Timestamp, bool, int , int>* query = nullptr;
 
     if (! query)
     {
-        query = new Command<Duration, bool, int, int>(*db, txt);
+        query = new Command<Duration, Timestamp, bool, int, int>(*db, txt);
         queries.push_back(query);
     }
     return *query;
 }
 
-static LogEntry makeLogEntry(int type, const Timestamp& timestamp, std::string&& userId, boost::optional<int>&& taskId)
+static InterruptedWork makeInterruptedWork(int taskId, const Timestamp& start, boost::optional<Timestamp>&& checkpoint)
 {
-    return LogEntry
+    return InterruptedWork
            {
-               static_cast<LogEntryType>(type),
-               timestamp,
-               std::forward<std::string>(userId),
-               std::forward<boost::optional<int> >(taskId)
+               taskId,
+               start,
+               std::forward<boost::optional<Timestamp> >(checkpoint)
            };
 }
 
-Query<LogEntry>&
-findAllLogsQ()
+Query<InterruptedWork, int>&
+findInterruptedWorkQ()
 {
-    static const char* txt = "SELECT L.type, L.timestamp, E.login, L.task\n"
-                             "FROM Logs AS L JOIN Employees AS E ON L.employee == E.id\n";
-    static Query<LogEntry>* query = nullptr;
+    // log entries are only appended, so the greatest seq is the latest entry
+    static const char* txt = "SELECT ET.task, L.timestamp, ET.checkpoint\n"
+                             "FROM EmployeesTasks AS ET\n"
+                             "JOIN Logs AS L ON L.seq = (SELECT MAX(seq) FROM Logs\n"
+                             "                             WHERE employee = ET.employee AND task = ET.task)\n"
+                             "WHERE ET.employee = ? AND NOT ET.finished AND L.type = 2\n"; // LogEntryType_TASK_START
+    static Query<InterruptedWork, int>* query = nullptr;
+
+    if (! query)
+    {
+        query = new Query<InterruptedWork, int>(*db, txt, makeInterruptedWork);
+        queries.push_back(query);
+    }
+    return *query;
+}
+
+static SequencedLogEntry makeSequencedLogEntry(int sequence,
+                                               int type,
+                                               const Timestamp& timestamp,
+                                               std::string&& userId,
+                                               boost::optional<int>&& taskId)
+{
+    return SequencedLogEntry
+           {
+               sequence,
+               LogEntry
+               {
+                   static_cast<LogEntryType>(type),
+                   timestamp,
+                   std::forward<std::string>(userId),
+                   std::forward<boost::optional<int> >(taskId)
+               }
+           };
+}
+
+Query<SequencedLogEntry, int>&
+findLogsAfterSequenceQ()
+{
+    // entries are only appended, so sequence numbers grow with time
+    static const char* txt = "SELECT L.seq, L.type, L.timestamp, E.login, L.task\n"
+                             "FROM Logs AS L JOIN Employees AS E ON L.employee == E.id\n"
+                             "WHERE L.seq > ?\n"
+                             "ORDER BY L.seq\n";
+    static Query<SequencedLogEntry, int>* query = nullptr;
 
     if (! query)
     {
-        query = new Query<LogEntry>(*db, txt, makeLogEntry);
+        query = new Query<SequencedLogEntry, int>(*commDb, txt, makeSequencedLogEntry);
         queries.push_back(query);
     }
     return *query;
 }
 
-Query<LogEntry, Timestamp>&
+Query<SequencedLogEntry, Timestamp>&
 findLogsNewerThanQ()
 {
-    static const char* txt = "SELECT L.type, L.timestamp, E.login, L.task\n"
+    static const char* txt = "SELECT L.seq, L.type, L.timestamp, E.login, L.task\n"
                              "FROM Logs AS L JOIN Employees AS E ON L.employee == E.id\n"
-                             "WHERE L.timestamp > ?\n";
-    static Query<LogEntry, Timestamp>* query = nullptr;
+                             "WHERE L.timestamp > ?\n"
+                             "ORDER BY L.seq\n";
+    static Query<SequencedLogEntry, Timestamp>* query = nullptr;
 
     if (! query)
     {
-        query = new Query<LogEntry, Timestamp>(*db, txt, makeLogEntry);
+        query = new Query<SequencedLogEntry, Timestamp>(*commDb, txt, makeSequencedLogEntry);
         queries.push_back(query);
     }
     return *query;
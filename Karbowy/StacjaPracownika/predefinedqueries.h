@@ -6,6 +6,9 @@
 
 void initializeDatabase();
 void shutdownDatabase();
+Database& database();
+// separate connection of communication thread, queries used only there are bound to it
+Database& communicationDatabase();
 
 Query<std::string>& retrieveUuidQ();
 Command<std::string>& insertUuidC();
@@ -13,17 +16,41 @@ Command<std::string>& insertUuidC();
 Query<int, std::string>& findUserIdByLoginQ();
 Command<std::string>& insertUserC();
 
-Command<int>& deleteTaskAssociationsForUserC();
+// version of server's task data last synchronized for employee, see RETRIEVE TASKS SINCE
+Query<int, std::string>& findTasksVersionQ();
+Command<int, std::string>& updateTasksVersionC();
+
+Query<int, int>& findTaskIdsForEmployeeQ();
+Command<int, int>& deleteTaskAssociationC();
 Command<int, std::string, std::string>& insertTaskC();
+Command<Duration, int, int>& updateTaskAssociationC();
 Command<int, int, Duration>& insertTaskAssociationC();
 
 class ClientTask;
 Query<std::unique_ptr<ClientTask>, int>& findActiveTasksForEmployeeQ();
 
 Command<LogEntryType, int, Timestamp, boost::optional<int> >& insertLogEntryC();
-Command<Duration, bool, int, int>& updateTimeSpentOnTaskC();
-
-Query<LogEntry>& findAllLogsQ();
-Query<LogEntry, Timestamp>& findLogsNewerThanQ();
+Command<Duration, Timestamp, bool, int, int>& updateTimeSpentOnTaskC();
+
+// Unfinished task whose last log entry is TASK_START, i.e. work on it was
+// interrupted without a pause (crash, power loss).
+struct InterruptedWork
+{
+    int _taskId;
+    Timestamp _start;
+    // when time spent was last stored, none for databases older than checkpoints
+    boost::optional<Timestamp> _checkpoint;
+};
+Query<InterruptedWork, int>& findInterruptedWorkQ();
+
+struct SequencedLogEntry
+{
+    // seq of entry, used as sequence number of LOG UPLOAD RESUMABLE
+    int _sequence;
+    LogEntry _entry;
+};
+Query<SequencedLogEntry, int>& findLogsAfterSequenceQ();
+// entries newer than last one server got by plain LOG UPLOAD, for first resumable upload
+Query<SequencedLogEntry, Timestamp>& findLogsNewerThanQ();
 
 #endif
@@ -2,11 +2,15 @@
 #include "predefinedqueries.h"
 #include "stringandtimeutils.h"
 #include <QMessageBox>
+#include <algorithm>
 #include <iostream>
 
-TaskTableModel::TaskTableModel(QObject *parent) :
+constexpr Duration TaskTableModel::DEFAULT_PERSIST_INTERVAL;
+
+TaskTableModel::TaskTableModel(QObject *parent, Duration persistInterval) :
     QAbstractTableModel(parent),
-    _employeeId(INVALID_EMPLOYEE_ID) { }
+    _employeeId(INVALID_EMPLOYEE_ID),
+    _persistInterval(persistInterval) { }
 
 int TaskTableModel::id(size_t rowIdx) const
 {
@@ -98,6 +102,7 @@ void TaskTableModel::setEmployeeId(int employeeId)
     if (employeeId != _employeeId)
     {
         _employeeId = employeeId;
+        recoverInterruptedWork();
         refresh();
     }
 }
@@ -114,18 +119,71 @@ void TaskTableModel::refresh()
         {
             newTasks.emplace_back(std::move(task));
         }
+        // time of running tasks since last persisted checkpoint is only in memory
+        for (const auto& oldTask : _tasks)
+        {
+            if (! oldTask->_workingNow)
+            {
+                continue;
+            }
+            auto newTask = std::find_if(newTasks.begin(), newTasks.end(),
+                                        [&](const std::unique_ptr<ClientTask>& t) { return t->_id == oldTask->_id; });
+            if (newTask != newTasks.end())
+            {
+                (*newTask)->_timeSpent = oldTask->_timeSpent;
+                (*newTask)->_lastCheckpoint = oldTask->_lastCheckpoint;
+                (*newTask)->_lastPersisted = oldTask->_lastPersisted;
+                (*newTask)->_workingNow = true;
+            }
+            else
+            {
+                // task is no longer assigned, work on it ends here
+                updateDuration(*oldTask, Clock::now());
+                persistDuration(*oldTask);
+                addLogEntry(LogEntryType_TASK_PAUSE, *oldTask);
+                oldTask->_workingNow = false;
+            }
+        }
         beginResetModel();
         _tasks = std::move(newTasks);
         endResetModel();
     }
 }
 
+// Work interrupted by a crash has TASK_START as the last log entry and time spent
+// stored up to the last checkpoint. Close it with a pause at that checkpoint, so
+// logs sent to the server agree with the stored time; at most one persist
+// interval of work is lost.
+void TaskTableModel::recoverInterruptedWork()
+{
+    auto& query = findInterruptedWorkQ();
+    query.execute(_employeeId);
+    std::vector<InterruptedWork> interrupted;
+    InterruptedWork work;
+    while (query.next(work))
+    {
+        interrupted.push_back(work);
+    }
+
+    for (const InterruptedWork& work : interrupted)
+    {
+        Timestamp end = work._start;
+        if (work._checkpoint && *work._checkpoint > end)
+        {
+            end = *work._checkpoint;
+        }
+        auto& addLogEntryCmd = insertLogEntryC();
+        addLogEntryCmd.execute(LogEntryType_TASK_PAUSE, _employeeId, end, boost::optional<int>(work._taskId));
+    }
+}
+
 void TaskTableModel::startWork(size_t idx)
 {
     Timestamp newCheckpoint = Clock::now();
     ClientTask& task = *_tasks.at(idx);
     assert(! task._workingNow);
     task._lastCheckpoint = newCheckpoint;
+    task._lastPersisted = newCheckpoint;
     addLogEntry(LogEntryType_TASK_START, task);
     task._workingNow = true;
     emit taskActivated(idx);
@@ -135,7 +193,16 @@ void TaskTableModel::workCheckpoint(size_t rowIdx)
 {
     Timestamp newCheckpoint = Clock::now();
     ClientTask& task = *_tasks.at(rowIdx);
+    if (! task._workingNow)
+    {
+        // timer tick that arrived after the task was paused
+        return;
+    }
     updateDuration(task, newCheckpoint);
+    if (newCheckpoint - task._lastPersisted >= _persistInterval)
+    {
+        persistDuration(task);
+    }
     QModelIndex idx = index(rowIdx, ColumnIndex_TIME_SPENT);
     emit dataChanged(idx, idx);
 }
@@ -145,6 +212,7 @@ void TaskTableModel::pauseWork(size_t rowIdx)
     Timestamp newCheckpoint = Clock::now();
     ClientTask& task = *_tasks.at(rowIdx);
     updateDuration(task, newCheckpoint);
+    persistDuration(task);
     addLogEntry(LogEntryType_TASK_PAUSE, task);
     task._workingNow = false;
     QModelIndex idx = index(rowIdx, ColumnIndex_TIME_SPENT);
@@ -158,7 +226,8 @@ void TaskTableModel::finishWork(size_t idx)
     ClientTask& task = *_tasks.at(idx);
     if (task._workingNow)
     {
-        updateDuration(task, newCheckpoint, true);
+        updateDuration(task, newCheckpoint);
+        persistDuration(task, true);
         addLogEntry(LogEntryType_TASK_FINISH, task);
         task._workingNow = false;
         QModelIndex idxx = index(idx, ColumnIndex_TIME_SPENT);
@@ -176,15 +245,31 @@ void TaskTableModel::finishWork(size_t idx)
     endRemoveRows();
 }
 
-void TaskTableModel::updateDuration(ClientTask& task, const Timestamp& newCheckpoint, bool finished)
+void TaskTableModel::pauseAllWork()
+{
+    for (size_t rowIdx = 0; rowIdx < _tasks.size(); ++rowIdx)
+    {
+        if (_tasks[rowIdx]->_workingNow)
+        {
+            pauseWork(rowIdx);
+        }
+    }
+}
+
+void TaskTableModel::updateDuration(ClientTask& task, const Timestamp& newCheckpoint)
 {
     assert(task._workingNow);
     task._timeSpent += newCheckpoint - task._lastCheckpoint;
-    auto& updateTimeSpentCmd = updateTimeSpentOnTaskC();
-    updateTimeSpentCmd.execute(task._timeSpent, finished, _employeeId, task._id);
     task._lastCheckpoint = newCheckpoint;
 }
 
+void TaskTableModel::persistDuration(ClientTask& task, bool finished)
+{
+    auto& updateTimeSpentCmd = updateTimeSpentOnTaskC();
+    updateTimeSpentCmd.execute(task._timeSpent, task._lastCheckpoint, finished, _employeeId, task._id);
+    task._lastPersisted = task._lastCheckpoint;
+}
+
 void TaskTableModel::addLogEntry(LogEntryType type, const ClientTask& task)
 {
     auto& addLogEntryCmd = insertLogEntryC();
@@ -22,7 +22,9 @@ public:
         COLUMN_COUNT
     };
 
-    TaskTableModel(QObject* parent);
+    // Time spent on running tasks is kept in memory and written to the database
+    // every persistInterval and when work is paused or finished.
+    TaskTableModel(QObject* parent, Duration persistInterval = DEFAULT_PERSIST_INTERVAL);
 
     int id(size_t rowidx) const;
     QString title(size_t rowIdx) const;
@@ -40,6 +42,8 @@ public:
     void workCheckpoint(size_t idx);
     void pauseWork(size_t idx);
     void finishWork(size_t idx);
+    // pauses all running tasks, call before shutdown
+    void pauseAllWork();
     void refresh();
 
 signals:
@@ -48,11 +52,15 @@ signals:
 
 private:
     static const int INVALID_EMPLOYEE_ID = -1;
+    static constexpr Duration DEFAULT_PERSIST_INTERVAL = std::chrono::seconds(60);
 
     int _employeeId;
+    Duration _persistInterval;
     std::vector<std::unique_ptr<ClientTask> > _tasks;
 
-    void updateDuration(ClientTask& task, const Timestamp& newCheckpoint, bool finished = false);
+    void recoverInterruptedWork();
+    void updateDuration(ClientTask& task, const Timestamp& newCheckpoint);
+    void persistDuration(ClientTask& task, bool finished = false);
     void deactivateTask(ClientTask& task);
     void addLogEntry(LogEntryType type, const ClientTask& task);
 };
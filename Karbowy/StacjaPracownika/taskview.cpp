@@ -40,7 +40,14 @@ void TaskView::setModel(TaskTableModel& model)
         _model = &model;
         connect(&model, &TaskTableModel::dataChanged, this, &TaskView::modelDataChanged);
         connect(&model, &TaskTableModel::taskActivated, [this](size_t rowIdx) { if (rowIdx == _rowIdx) setActive(true); });
-        connect(&model, &TaskTableModel::taskDeactivated, [this](size_t rowIdx) { if (rowIdx == _rowIdx) setActive(false); });
+        connect(&model, &TaskTableModel::taskDeactivated, [this](size_t rowIdx)
+                {
+                    if (rowIdx == _rowIdx)
+                    {
+                        _timer->stop();
+                        setActive(false);
+                    }
+                });
     }
 }
 
@@ -22,9 +22,15 @@ SOURCES += main.cpp\
     listeners.cpp \
     server.cpp \
     clientconnection.cpp \
+    sessionhelpers.cpp \
+    clientsession.cpp \
+    reactor.cpp \
+    logingestor.cpp \
+    logprocessingqueue.cpp \
     predefinedqueries.cpp \
     logprocessor.cpp \
-    taskassignmentdialog.cpp
+    taskassignmentdialog.cpp \
+    tasklistcache.cpp
 
 HEADERS  += mainwindow.h \
     employee.h \
@@ -33,11 +39,17 @@ HEADERS  += mainwindow.h \
     taskstablemodel.h \
     commongui.h \
     clientconnection.h \
+    sessionhelpers.h \
+    clientsession.h \
+    reactor.h \
+    logingestor.h \
+    logprocessingqueue.h \
     server.h \
     predefinedqueries.h \
     serverlogentry.h \
     logprocessor.h \
-    taskassignmentdialog.h
+    taskassignmentdialog.h \
+    tasklistcache.h
 
 FORMS    += mainwindow.ui \
     taskassignmentdialog.ui
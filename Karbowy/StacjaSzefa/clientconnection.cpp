@@ -4,11 +4,12 @@
 #include "concat.h"
 #include "protocolerror.h"
 #include "server.h"
-#include "predefinedqueries.h"
+#include "sessionhelpers.h"
+#include "logingestor.h"
 #include "employee.h"
 #include "task.h"
-// #include "serverlogentry.h"
-#include "logprocessor.h"
+#include "logentry.h"
+#include "framing.h"
 #include <boost/algorithm/string.hpp>
 #include <signal.h>
 #include <iostream>
@@ -16,7 +17,8 @@
 ClientConnection::ClientConnection(Server& server, TcpStream&& stream) :
     _server(server),
     _stream(std::move(stream)),
-    _run(false) { }
+    _run(false),
+    _binaryFraming(false) { }
 
 void ClientConnection::start()
 {
@@ -35,30 +37,6 @@ void ClientConnection::waitToFinish()
     _thread.join();
 }
 
-std::unique_ptr<Employee> ClientConnection::verifyUserId(const std::string& userId)
-{
-    auto& query = findEmployeeByLoginQ();
-    query.execute(userId);
-    std::unique_ptr<Employee> employee;
-    if (! query.next(employee))
-    {
-        std::cerr << "Can't find employee id '" << userId << '\'' << std::endl;
-        return std::unique_ptr<Employee>();
-    }
-    if (query.next(employee))
-    {
-        while (query.next(employee)) { }
-        std::cerr << "Found more than one employee with id '" << userId << '\'' << std::endl;
-        return std::unique_ptr<Employee>();
-    }
-    if (! employee->_active)
-    {
-        std::cerr << "Employee '" << userId << "' is not active" << std::endl;
-        return std::unique_ptr<Employee>();
-    }
-    return employee;
-}
-
 bool ClientConnection::initializeConnection()
 {
     std::string serverChallenge = receiveServerChallenge(_stream);
@@ -92,128 +70,196 @@ bool ClientConnection::initializeConnection()
         return false;
     }
 
-    auto& insertClientUuid = insertClientUuidC();
-    insertClientUuid.execute(clientUuid);
-    auto& findClientIdByUuid = findClientIdByUuidQ();
-    findClientIdByUuid.execute(clientUuid);
-    if (! findClientIdByUuid.next(_clientId))
-    {
-        throw std::runtime_error("Client id not found after insert");
-    }
-    if (findClientIdByUuid.next(_clientId))
-    {
-        throw std::runtime_error("Many client ids found after insert");
-    }
+    _clientId = registerClient(clientUuid);
     _userId = userId;
     return true;
 }
 
 void ClientConnection::handleCommand(const std::string& line)
 {
+    int sinceVersion;
     if (boost::iequals(line, "RETRIEVE TASKS"))
     {
-        auto& query = findTasksForLoginQ();
-        query.execute(_userId);
-        std::unique_ptr<ClientTask> task;
-        while (query.next(task))
+        sendTasks();
+    }
+    else if (parse(line, "RETRIEVE TASKS SINCE ", IntToken(sinceVersion)))
+    {
+        sendTaskChanges(sinceVersion);
+    }
+    else if (boost::iequals(line, "LOG UPLOAD"))
+    {
+        receiveLogs();
+    }
+    else if (boost::iequals(line, "LOG UPLOAD RESUMABLE"))
+    {
+        receiveLogsResumable();
+    }
+    else if (boost::iequals(line, "FRAMING BINARY"))
+    {
+        _binaryFraming = _server.config()._binaryFraming;
+        _stream.writeLine(_binaryFraming ? "FRAMING BINARY OK\n" : "FRAMING TEXT\n");
+    }
+    else
+    {
+        throw ProtocolError("Invalid command", line);
+    }
+}
+
+void ClientConnection::sendTasks()
+{
+    _stream.write(tasksResponse(_userId, _binaryFraming));
+    _stream.flush();
+}
+
+void ClientConnection::sendTaskChanges(int sinceVersion)
+{
+    _stream.write(formatTaskListDelta(findTaskChangesForEmployee(_userId, sinceVersion), _binaryFraming));
+    _stream.flush();
+}
+
+void ClientConnection::receiveLogs()
+{
+    boost::optional<Timestamp> lastEntryTime = findLastLogEntryTime(_clientId);
+    if (lastEntryTime)
+    {
+        _stream.writeLineOf("LAST ENTRY AT ", *lastEntryTime);
+    }
+    else
+    {
+        _stream.writeLine("NO ENTRYS\n");
+    }
+    LogIngestor ingestor(_clientId, _server.config()._ingestion);
+    if (_binaryFraming)
+    {
+        while (true)
         {
-            _stream.writeLine(concatln("TASK ", task->_id, " TITLE ", quoteString(task->_title), " SPENT ", toSeconds(task->_timeSpent)));
-            for (const auto& line : task->_description)
+            std::string frame = _stream.readFrame();
+            if (frame.empty())
+            {
+                break;
+            }
+            boost::string_view payload(frame);
+            while (! payload.empty())
             {
-                _stream.writeLine(concatln(line));
+                LogEntry entry;
+                if (! parseLogEntryRecord(payload, entry))
+                {
+                    throw ProtocolError("Invalid log entry record", std::string());
+                }
+                ingestor.add(std::move(entry));
             }
-            _stream.writeLine("\n");
         }
-        _stream.writeLine("END TASKS\n");
     }
-    else if (boost::iequals(line, "LOG UPLOAD"))
+    else
     {
-        auto& lastEntryTimeQ = findLastLogEntryTimeForClientQ();
-        lastEntryTimeQ.execute(_clientId);
-        boost::optional<Timestamp> lastEntryTime;
-        bool res = lastEntryTimeQ.next(lastEntryTime);
-        assert(res);
-        assert(! lastEntryTimeQ.next(lastEntryTime));
-        if (lastEntryTime)
-        {
-            _stream.writeLine(concatln("LAST ENTRY AT ", formatTimestamp(*lastEntryTime)));
-        }
-        else
-        {
-            _stream.writeLine("NO ENTRYS\n");
-        }
-        int taskId;
-        std::set<std::string> employeeIds;
-        bool loop = true;
-        while (loop)
+        while (true)
         {
             auto line = _stream.readLine();
-            LogEntry entry;
-            if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId), " LOGIN"))
-            {
-                entry._type = LogEntryType_LOGIN;
-            }
-            else if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId), " LOGOUT"))
+            if (boost::iequals(line, "END LOG"))
             {
-                entry._type = LogEntryType_LOGOUT;
+                break;
             }
-            else if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId),
-                           " TASK ", IntToken(taskId), " START"))
+            LogEntry entry;
+            if (! parseLogEntry(line, entry))
             {
-                entry._type = LogEntryType_TASK_START;
-                entry._taskId = taskId;
+                throw ProtocolError("Invalid log entry", line);
             }
-            else if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId),
-                           " TASK ", IntToken(taskId), " PAUSE"))
+            ingestor.add(std::move(entry));
+        }
+    }
+    ingestor.finish();
+    for (const auto& employeeId : ingestor.employeeIds())
+    {
+        _server.logProcessingQueue().enqueue(employeeId);
+    }
+}
+
+void ClientConnection::receiveLogsResumable()
+{
+    boost::optional<Timestamp> lastEntryTime;
+    int lastSequence = findLastSequence(_clientId, lastEntryTime);
+    _stream.write(formatLastSequence(lastSequence, lastEntryTime));
+    LogIngestor ingestor(_clientId, _server.config()._ingestion);
+    int receivedSequence = lastSequence;
+    int acknowledgedSequence = lastSequence;
+    auto add = [&](int sequence, LogEntry&& entry)
+    {
+        if (sequence <= receivedSequence)
+        {
+            throw ProtocolError("Log entry sequence number not increasing", std::to_string(sequence));
+        }
+        receivedSequence = sequence;
+        ingestor.add(sequence, std::move(entry));
+    };
+    // buffered ACK goes out when stream flushes before waiting for more entries
+    auto acknowledge = [&]()
+    {
+        int committedSequence = ingestor.committedSequence();
+        if (committedSequence > acknowledgedSequence)
+        {
+            acknowledgedSequence = committedSequence;
+            _stream.writeLineOf("ACK ", committedSequence);
+        }
+    };
+    if (_binaryFraming)
+    {
+        while (true)
+        {
+            std::string frame = _stream.readFrame();
+            if (frame.empty())
             {
-                entry._type = LogEntryType_TASK_PAUSE;
-                entry._taskId = taskId;
+                break;
             }
-            else if (parse(line, TimestampToken(entry._timestamp), " ", BareStringToken(entry._userId),
-                           " TASK ", IntToken(taskId), " FINISH"))
+            boost::string_view payload(frame);
+            while (! payload.empty())
             {
-                entry._type = LogEntryType_TASK_FINISH;
-                entry._taskId = taskId;
+                int sequence;
+                LogEntry entry;
+                if (! parseSequencedLogEntryRecord(payload, sequence, entry))
+                {
+                    throw ProtocolError("Invalid log entry record", std::string());
+                }
+                add(sequence, std::move(entry));
             }
-            else if (boost::iequals(line, "END LOG"))
+            acknowledge();
+        }
+    }
+    else
+    {
+        while (true)
+        {
+            auto line = _stream.readLine();
+            if (boost::iequals(line, "END LOG"))
             {
-                loop = false;
+                break;
             }
-            else
+            int sequence;
+            LogEntry entry;
+            if (! parseSequencedLogEntry(line, sequence, entry))
             {
                 throw ProtocolError("Invalid log entry", line);
             }
-
-            if (loop)
-            {
-                employeeIds.insert(entry._userId);
-                insertLogEntry(entry);
-            }
+            add(sequence, std::move(entry));
+            acknowledge();
         }
-        for (const auto& employeeId : employeeIds)
-        {
-            processLogs(employeeId);
-        }
-        emit tasksStatusChanged();
     }
-    else
+    ingestor.finish();
+    _stream.writeLineOf("LOG COMMITTED ", receivedSequence);
+    _stream.flush();
+    for (const auto& employeeId : ingestor.employeeIds())
     {
-        throw ProtocolError("Invalid command", line);
+        _server.logProcessingQueue().enqueue(employeeId);
     }
 }
 
-void ClientConnection::insertLogEntry(const LogEntry& entry)
-{
-    auto& cmd = insertLogEntryC();
-    cmd.execute(entry._type, _clientId, entry._userId, entry._timestamp, entry._taskId);
-}
-
 void ClientConnection::run()
 {
     try
     {
         if (initializeConnection())
         {
+            // after handshake responses are collected and sent in large writes
+            _stream.setBuffered();
             while (_run)
             {
                 handleCommand(_stream.readLine());
@@ -226,17 +272,3 @@ void ClientConnection::run()
     }
     _server.removeClient(shared_from_this());
 }
-
-void ClientConnection::processLogs(const std::string& employeeId)
-{
-    LogProcessor processor(employeeId);
-    processor.checkEmployeeId();
-    auto& query = findUnprocessedLogEntriesForEmployeeQ();
-    query.execute(employeeId);
-    ServerLogEntry entry;
-    while (query.next(entry))
-    {
-        processor.process(std::move(entry));
-    }
-    processor.finish();
-}
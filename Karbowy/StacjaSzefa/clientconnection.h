@@ -4,26 +4,18 @@
 #include "sockets.h"
 #include <thread>
 #include <atomic>
-#include <QObject>
+#include <memory>
 
 class Server;
-class Employee;
-class LogEntry;
 
-class ClientConnection : public QObject,
-                         public std::enable_shared_from_this<ClientConnection>
+class ClientConnection : public std::enable_shared_from_this<ClientConnection>
 {
-    Q_OBJECT;
-
 public:
     ClientConnection(Server& server, TcpStream&& stream);
     void start();
     void stop();
     void waitToFinish();
 
-signals:
-    void tasksStatusChanged();
-
 private:
     Server &_server;
     TcpStream _stream;
@@ -31,15 +23,15 @@ private:
     std::thread _thread;
     int _clientId;
     std::string _userId;
+    bool _binaryFraming;
 
     void run();
     bool initializeConnection();
-    static std::unique_ptr<Employee> verifyUserId(const std::string& userId);
-
-
     void handleCommand(const std::string& line);
-    void insertLogEntry(const LogEntry& entry);
-    void processLogs(const std::string& employeeId);
+    void sendTasks();
+    void sendTaskChanges(int sinceVersion);
+    void receiveLogs();
+    void receiveLogsResumable();
 };
 
 #endif // CLIENTCONNECTION_H
@@ -0,0 +1,173 @@
+#include "clientsession.h"
+#include "reactor.h"
+#include "sessionhelpers.h"
+#include "predefinedqueries.h"
+#include "databasewriter.h"
+#include "employee.h"
+#include "task.h"
+#include <iostream>
+
+using namespace std::placeholders;
+
+ClientSession::ClientSession(Reactor& reactor, MainLoop& mainLoop, Descriptor&& fd, const std::string& serverUuid) :
+    _reactor(reactor),
+    _conn(mainLoop, std::move(fd), serverUuid, reactor.config()._binaryFraming, callbacks(), std::bind(&ClientSession::onError, this, _1)),
+    _clientId(-1),
+    _lifeToken(std::make_shared<char>()) { }
+
+void ClientSession::start()
+{
+    _conn.start();
+}
+
+void ClientSession::stop()
+{
+    _conn.stop();
+}
+
+ServerCallbacks ClientSession::callbacks()
+{
+    ServerCallbacks callbacks;
+    callbacks._findPassword = std::bind(&ClientSession::findPassword, this, _1);
+    callbacks._onLogin = std::bind(&ClientSession::onLogin, this, _1, _2, _3);
+    callbacks._retrieveTasks = std::bind(&ClientSession::retrieveTasks, this, _1);
+    callbacks._retrieveTaskChanges = std::bind(&ClientSession::retrieveTaskChanges, this, _1);
+    callbacks._lastLogEntryTime = std::bind(&ClientSession::lastLogEntryTime, this);
+    callbacks._onLogEntry = std::bind(&ClientSession::onLogEntry, this, _1);
+    callbacks._onLogsReceived = std::bind(&ClientSession::onLogsReceived, this, _1);
+    callbacks._lastSequence = std::bind(&ClientSession::lastSequence, this, _1);
+    callbacks._onSequencedLogEntry = std::bind(&ClientSession::onSequencedLogEntry, this, _1, _2);
+    callbacks._committedSequence = std::bind(&ClientSession::committedSequence, this);
+    return callbacks;
+}
+
+boost::optional<std::string> ClientSession::findPassword(const std::string& userId)
+{
+    std::unique_ptr<Employee> employee = verifyUserId(userId);
+    if (employee)
+    {
+        return employee->_password;
+    }
+    else
+    {
+        return boost::none;
+    }
+}
+
+void ClientSession::onLogin(const std::string& clientUuid, const std::string& userId, const ServerCallbacks::LoginDoneCallback& onDone)
+{
+    _userId = userId;
+    // reactor's thread doesn't wait for writer, handshake goes on when client is stored
+    auto clientId = std::make_shared<int>(-1);
+    auto registered = std::make_shared<std::future<void> >(databaseWriter().submit([clientUuid, clientId](Database&)
+    {
+        *clientId = storeClient(clientUuid);
+    }));
+    // empty job is done after the one above, so that its result is ready, as in LogIngestor::finishAsync
+    Reactor& reactor = _reactor;
+    std::weak_ptr<char> lifeToken = _lifeToken;
+    databaseWriter().submit([](Database&) { }, [this, &reactor, lifeToken, registered, clientId, onDone]()
+    {
+        reactor.post([this, lifeToken, registered, clientId, onDone]()
+        {
+            if (! lifeToken.expired())
+            {
+                afterClientRegistered(*registered, *clientId, onDone);
+            }
+        });
+    });
+}
+
+void ClientSession::afterClientRegistered(std::future<void>& registered, int clientId, const ServerCallbacks::LoginDoneCallback& onDone)
+{
+    std::string errorMsg;
+    try
+    {
+        registered.get();
+        _clientId = clientId;
+    }
+    catch (std::exception& ex)
+    {
+        errorMsg = ex.what();
+    }
+    onDone(errorMsg);
+}
+
+std::string ClientSession::retrieveTasks(bool binaryFraming)
+{
+    return tasksResponse(_userId, binaryFraming);
+}
+
+TaskListDelta ClientSession::retrieveTaskChanges(int sinceVersion)
+{
+    return findTaskChangesForEmployee(_userId, sinceVersion);
+}
+
+boost::optional<Timestamp> ClientSession::lastLogEntryTime()
+{
+    _ingestor = std::make_unique<LogIngestor>(_clientId, _reactor.config()._ingestion);
+    return findLastLogEntryTime(_clientId);
+}
+
+void ClientSession::onLogEntry(LogEntry&& entry)
+{
+    _ingestor->add(std::move(entry));
+}
+
+int ClientSession::lastSequence(boost::optional<Timestamp>& lastEntryTime)
+{
+    _ingestor = std::make_unique<LogIngestor>(_clientId, _reactor.config()._ingestion);
+    return findLastSequence(_clientId, lastEntryTime);
+}
+
+void ClientSession::onSequencedLogEntry(int sequence, LogEntry&& entry)
+{
+    _ingestor->add(sequence, std::move(entry));
+}
+
+int ClientSession::committedSequence()
+{
+    return _ingestor->committedSequence();
+}
+
+void ClientSession::onLogsReceived(const ServerCallbacks::LogsStoredCallback& onStored)
+{
+    Reactor& reactor = _reactor;
+    std::weak_ptr<char> lifeToken = _lifeToken;
+    _ingestor->finishAsync([this, &reactor, lifeToken, onStored]()
+    {
+        reactor.post([this, lifeToken, onStored]()
+        {
+            if (! lifeToken.expired())
+            {
+                afterLogsStored(onStored);
+            }
+        });
+    });
+}
+
+void ClientSession::afterLogsStored(const ServerCallbacks::LogsStoredCallback& onStored)
+{
+    std::string errorMsg;
+    try
+    {
+        // all batches are already done, doesn't wait
+        _ingestor->finish();
+        for (const auto& employeeId : _ingestor->employeeIds())
+        {
+            _reactor.logProcessingQueue().enqueue(employeeId);
+        }
+    }
+    catch (std::exception& ex)
+    {
+        errorMsg = ex.what();
+    }
+    _ingestor.reset();
+    onStored(errorMsg);
+}
+
+void ClientSession::onError(const std::string& errorMsg)
+{
+    std::cerr << "Client exception: " << errorMsg << std::endl;
+    _reactor.removeSession(*this);
+}
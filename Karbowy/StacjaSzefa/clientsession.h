@@ -0,0 +1,46 @@
+#ifndef CLIENTSESSION_H
+#define CLIENTSESSION_H
+
+#include "protocol.h"
+#include "logingestor.h"
+#include <future>
+#include <memory>
+#include <string>
+
+class Reactor;
+
+// State of single client handled by Reactor. All methods run on reactor's thread.
+class ClientSession
+{
+public:
+    ClientSession(Reactor& reactor, MainLoop& mainLoop, Descriptor&& fd, const std::string& serverUuid);
+    ClientSession(const ClientSession&) = delete;
+
+    void start();
+    void stop();
+private:
+    Reactor& _reactor;
+    AsyncServerConnection _conn;
+    int _clientId;
+    std::string _userId;
+    std::unique_ptr<LogIngestor> _ingestor;
+    // expires when session is destroyed, tasks posted from writer's thread may outlive it
+    std::shared_ptr<char> _lifeToken;
+
+    ServerCallbacks callbacks();
+    boost::optional<std::string> findPassword(const std::string& userId);
+    void onLogin(const std::string& clientUuid, const std::string& userId, const ServerCallbacks::LoginDoneCallback& onDone);
+    void afterClientRegistered(std::future<void>& registered, int clientId, const ServerCallbacks::LoginDoneCallback& onDone);
+    std::string retrieveTasks(bool binaryFraming);
+    TaskListDelta retrieveTaskChanges(int sinceVersion);
+    boost::optional<Timestamp> lastLogEntryTime();
+    void onLogEntry(LogEntry&& entry);
+    int lastSequence(boost::optional<Timestamp>& lastEntryTime);
+    void onSequencedLogEntry(int sequence, LogEntry&& entry);
+    int committedSequence();
+    void onLogsReceived(const ServerCallbacks::LogsStoredCallback& onStored);
+    void afterLogsStored(const ServerCallbacks::LogsStoredCallback& onStored);
+    void onError(const std::string& errorMsg);
+};
+
+#endif // CLIENTSESSION_H
@@ -1,5 +1,6 @@
 #include "employeetablemodel.h"
 #include "commongui.h"
+#include "tasklistcache.h"
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QSqlField>
@@ -132,7 +133,14 @@ bool EmployeeTableModel::setLogin(const QString& oldLogin, const QString& newLog
     q.prepare(setLoginQ);
     q.addBindValue(newLogin);
     q.addBindValue(oldLogin);
-    return execQuery(q);
+    if (! execQuery(q))
+    {
+        return false;
+    }
+    // lists are cached by login
+    taskListCache().invalidate(oldLogin.toStdString());
+    taskListCache().invalidate(newLogin.toStdString());
+    return true;
 }
 
 bool EmployeeTableModel::setPassword(const QString& login, const QString& password)
@@ -159,7 +167,13 @@ bool EmployeeTableModel::setActive(const QString& login, bool active)
     q.prepare(setActiveQ);
     q.addBindValue(active);
     q.addBindValue(login);
-    return execQuery(q);
+    if (! execQuery(q))
+    {
+        return false;
+    }
+    // task changes made while employee was inactive may be missing from cached list
+    taskListCache().invalidate(login.toStdString());
+    return true;
 }
 
 void EmployeeTableModel::refresh()
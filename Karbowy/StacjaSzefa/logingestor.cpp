@@ -0,0 +1,117 @@
+#include "logingestor.h"
+#include "sessionhelpers.h"
+#include "predefinedqueries.h"
+#include "databasewriter.h"
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+
+IngestionConfig::IngestionConfig() :
+    _batchSize(0) { }
+
+LogIngestor::LogIngestor(int clientId, const IngestionConfig& config) :
+    _clientId(clientId),
+    _config(config),
+    _committedSequence(0),
+    _failed(std::make_shared<bool>(false)) { }
+
+LogIngestor::~LogIngestor()
+{
+    // onStored may still be running; batches themselves don't refer to ingestor
+    if (_stored.valid())
+    {
+        _stored.wait();
+    }
+}
+
+void LogIngestor::add(LogEntry&& entry)
+{
+    _employeeIds.insert(entry._userId);
+    _batch._entries.emplace_back(std::move(entry));
+    if (_config._batchSize > 0 && _batch._entries.size() >= _config._batchSize)
+    {
+        flushBatch();
+    }
+}
+
+void LogIngestor::add(int sequence, LogEntry&& entry)
+{
+    _batch._sequences.push_back(sequence);
+    add(std::move(entry));
+}
+
+void LogIngestor::finishAsync(const StoredCallback& onStored)
+{
+    assert(! _stored.valid());
+    flushBatch();
+    // writer executes jobs in order, so this one is done after all batches
+    _stored = databaseWriter().submit([](Database&) { }, onStored);
+}
+
+void LogIngestor::finish()
+{
+    flushBatch();
+    collectBatches(true);
+}
+
+int LogIngestor::committedSequence()
+{
+    collectBatches(false);
+    return _committedSequence;
+}
+
+void LogIngestor::flushBatch()
+{
+    collectBatches(false);
+    if (_batch._entries.empty())
+    {
+        return;
+    }
+    // std::function has to be copyable
+    auto batch = std::make_shared<Batch>(std::move(_batch));
+    _batch = Batch();
+    int clientId = _clientId;
+    auto failed = _failed;
+    PendingBatch pending;
+    pending._lastSequence = batch->_sequences.empty() ? 0 : batch->_sequences.back();
+    pending._result = databaseWriter().submit([clientId, batch, failed](Database&)
+    {
+        // entries after lost ones would move client's last sequence past them
+        if (*failed)
+        {
+            throw std::runtime_error("Earlier batch of log entries failed");
+        }
+        try
+        {
+            if (batch->_sequences.empty())
+            {
+                storeLogEntries(clientId, batch->_entries);
+            }
+            else
+            {
+                storeLogEntries(clientId, batch->_entries, batch->_sequences);
+            }
+        }
+        catch (...)
+        {
+            *failed = true;
+            throw;
+        }
+    });
+    _pendingBatches.emplace_back(std::move(pending));
+}
+
+void LogIngestor::collectBatches(bool wait)
+{
+    while (! _pendingBatches.empty())
+    {
+        if (! wait && _pendingBatches.front()._result.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            break;
+        }
+        PendingBatch batch = std::move(_pendingBatches.front());
+        _pendingBatches.pop_front();
+        batch._result.get();
+        _committedSequence = std::max(_committedSequence, batch._lastSequence);
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef LOGINGESTOR_H
+#define LOGINGESTOR_H
+
+#include "logentry.h"
+#include <set>
+#include <vector>
+#include <deque>
+#include <future>
+#include <functional>
+#include <memory>
+
+struct IngestionConfig
+{
+    IngestionConfig();
+
+    // number of entries committed in one transaction, 0 means whole upload in one transaction
+    size_t _batchSize;
+};
+
+// Collects entries of single LOG UPLOAD and hands them to databaseWriter() in batches,
+// so that parsing of next lines is not stalled by commit. Only finish() waits for database.
+// Entries of LOG UPLOAD RESUMABLE come with sequence numbers, all entries have to be added the same way.
+class LogIngestor
+{
+public:
+    // called on writer's thread
+    typedef std::function<void()> StoredCallback;
+
+    LogIngestor(int clientId, const IngestionConfig& config);
+    LogIngestor(const LogIngestor&) = delete;
+    ~LogIngestor();
+
+    void add(LogEntry&& entry);
+    void add(int sequence, LogEntry&& entry);
+    // hands over remaining entries, onStored is called when all batches are committed or failed;
+    // finish() called after that doesn't wait
+    void finishAsync(const StoredCallback& onStored);
+    // commits remaining entries and waits for all pending batches, rethrows error of failed batch
+    void finish();
+
+    const std::set<std::string>& employeeIds() const
+    {
+        return _employeeIds;
+    }
+
+    // client's sequence number of last entry stored in database, 0 if no batch was committed yet
+    int committedSequence();
+
+private:
+    struct Batch
+    {
+        std::vector<LogEntry> _entries;
+        // sequence numbers of entries, empty if upload isn't resumable
+        std::vector<int> _sequences;
+    };
+
+    struct PendingBatch
+    {
+        std::future<void> _result;
+        int _lastSequence;
+    };
+
+    int _clientId;
+    IngestionConfig _config;
+    Batch _batch;
+    std::set<std::string> _employeeIds;
+    int _committedSequence;
+    std::deque<PendingBatch> _pendingBatches;
+    // set on writer's thread when batch fails, following batches are rejected then
+    std::shared_ptr<bool> _failed;
+    // becomes ready after onStored passed to finishAsync returns
+    std::future<void> _stored;
+
+    void flushBatch();
+    // forgets committed batches from front of queue, rethrows error of failed one
+    void collectBatches(bool wait);
+};
+
+#endif // LOGINGESTOR_H
@@ -0,0 +1,108 @@
+#include "logprocessingqueue.h"
+#include "sessionhelpers.h"
+#include <iostream>
+
+LogProcessingQueue::LogProcessingQueue(unsigned numOfWorkers) :
+    _numOfWorkers(numOfWorkers),
+    _stopping(false) { }
+
+LogProcessingQueue::~LogProcessingQueue()
+{
+    stop();
+}
+
+void LogProcessingQueue::start()
+{
+    assert(_workers.empty());
+    _stopping = false;
+    for (unsigned i = 0; i < _numOfWorkers; ++i)
+    {
+        _workers.emplace_back(&LogProcessingQueue::runWorker, this);
+    }
+}
+
+void LogProcessingQueue::stop()
+{
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _stopping = true;
+    }
+    _condition.notify_all();
+    for (auto& worker : _workers)
+    {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+void LogProcessingQueue::enqueue(const std::string& employeeId)
+{
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        if (_inProgress.find(employeeId) != _inProgress.end())
+        {
+            _rerun.insert(employeeId);
+            return;
+        }
+        if (! _queued.insert(employeeId).second)
+        {
+            return;
+        }
+        _queue.push_back(employeeId);
+    }
+    _condition.notify_one();
+}
+
+bool LogProcessingQueue::takeEmployee(std::string& employeeId)
+{
+    std::unique_lock<std::mutex> lock(_mutex);
+    _condition.wait(lock, [this]() { return _stopping || ! _queue.empty(); });
+    if (_queue.empty())
+    {
+        return false;
+    }
+    employeeId = std::move(_queue.front());
+    _queue.pop_front();
+    _queued.erase(employeeId);
+    _inProgress.insert(employeeId);
+    return true;
+}
+
+void LogProcessingQueue::employeeDone(const std::string& employeeId)
+{
+    bool again;
+    {
+        std::lock_guard<std::mutex> guard(_mutex);
+        _inProgress.erase(employeeId);
+        again = _rerun.erase(employeeId) > 0;
+        if (again)
+        {
+            _queued.insert(employeeId);
+            _queue.push_back(employeeId);
+        }
+    }
+    if (again)
+    {
+        _condition.notify_one();
+    }
+}
+
+void LogProcessingQueue::runWorker()
+{
+    std::string employeeId;
+    while (takeEmployee(employeeId))
+    {
+        try
+        {
+            if (processLogs(employeeId))
+            {
+                emit tasksStatusChanged();
+            }
+        }
+        catch (std::exception& ex)
+        {
+            std::cerr << "Log processing for '" << employeeId << "' failed: " << ex.what() << std::endl;
+        }
+        employeeDone(employeeId);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef LOGPROCESSINGQUEUE_H
+#define LOGPROCESSINGQUEUE_H
+
+#include <QObject>
+#include <string>
+#include <deque>
+#include <set>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Processes uploaded logs in the background, employees are processed in parallel.
+// Requests for employee already waiting in the queue are coalesced, requests for
+// employee being processed cause one more run after the current one.
+class LogProcessingQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    LogProcessingQueue(unsigned numOfWorkers);
+    ~LogProcessingQueue();
+
+    void start();
+    // processes everything already enqueued, then stops workers
+    void stop();
+    void enqueue(const std::string& employeeId);
+
+signals:
+    void tasksStatusChanged();
+
+private:
+    unsigned _numOfWorkers;
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _condition;
+    std::deque<std::string> _queue;
+    std::set<std::string> _queued;
+    std::set<std::string> _inProgress;
+    std::set<std::string> _rerun;
+    bool _stopping;
+
+    bool takeEmployee(std::string& employeeId);
+    void employeeDone(const std::string& employeeId);
+    void runWorker();
+};
+
+#endif // LOGPROCESSINGQUEUE_H
@@ -1,6 +1,7 @@
 #include "logprocessor.h"
 #include "predefinedqueries.h"
 #include "employee.h"
+#include <algorithm>
 #include <iostream>
 
 std::ostream& operator<<(std::ostream& stream, LogEntryType type)
@@ -24,7 +25,8 @@ std::ostream& operator<<(std::ostream& stream, LogEntryType type)
 
 LogProcessor::LogProcessor(const std::string &employeeId) :
     _employeeId(employeeId),
-    _employeeIsValid(false) { }
+    _employeeIsValid(false),
+    _lastEntryId(0) { }
 
 
 void LogProcessor::checkEmployeeId()
@@ -35,6 +37,7 @@ void LogProcessor::checkEmployeeId()
     if (query.next(employee))
     {
         _employeeIsValid = true;
+        query.reset();
     }
     else
     {
@@ -42,11 +45,22 @@ void LogProcessor::checkEmployeeId()
     }
 }
 
+void LogProcessor::loadAssignments()
+{
+    auto& query = findAssignmentsForEmployeeQ();
+    query.execute(_employeeId);
+    TaskAssignment assignment;
+    while (query.next(assignment))
+    {
+        _assignments[assignment._taskId] = assignment._status;
+    }
+}
+
 void LogProcessor::process(ServerLogEntry&& entry)
 {
+    _lastEntryId = std::max(_lastEntryId, entry._id);
     if (! preliminaryValidate(entry))
     {
-        _processed.push_back(entry._id);
         return;
     }
 
@@ -58,7 +72,6 @@ void LogProcessor::process(ServerLogEntry&& entry)
             invalidEntryMsg(entry) << "login before logout (previous login "
                                    << formatTimestamp(_loginEntry->_entry._timestamp)
                                    << " at " << _loginEntry->_clientId << ')' << std::endl;
-            _processed.push_back(_loginEntry->_id);
         }
         _loginEntry = std::move(entry);
         break;
@@ -75,10 +88,8 @@ void LogProcessor::process(ServerLogEntry&& entry)
                                                  << formatTimestamp(_loginEntry->_entry._timestamp)
                                                  << " at " << _loginEntry->_clientId << std::endl;
             }
-            _processed.push_back(_loginEntry->_id);
             _loginEntry = boost::none;
         }
-        _processed.push_back(entry._id);
         break;
     case LogEntryType_TASK_START:
     {
@@ -90,7 +101,6 @@ void LogProcessor::process(ServerLogEntry&& entry)
             invalidEntryMsg(entry) << "work start before work stop (previous start "
                                    << formatTimestamp(prevEntry._entry._timestamp)
                                    << " at " << prevEntry._clientId << ')' << std::endl;
-            _processed.push_back(prevEntry._id);
             prevEntry = std::move(entry);
         }
         else
@@ -117,15 +127,13 @@ void LogProcessor::process(ServerLogEntry&& entry)
             {
                 auto assignment = _assignments.find(taskId);
                 assignment->second._timeSpent += entry._entry._timestamp - prevEntry._entry._timestamp;
+                _changedAssignments.insert(taskId);
             }
-            _processed.push_back(prevEntry._id);
-            _processed.push_back(entry._id);
             _workStartEntrys.erase(workStartEntry);
         }
         else
         {
             invalidEntryMsg(entry) << "work pause before work start" << std::endl;
-            _processed.push_back(entry._id);
         }
         break;
     }
@@ -147,33 +155,44 @@ void LogProcessor::process(ServerLogEntry&& entry)
                 auto assignment = _assignments.find(taskId);
                 assignment->second._timeSpent += entry._entry._timestamp - prevEntry._entry._timestamp;
                 assignment->second._finished = true;
+                _changedAssignments.insert(taskId);
             }
-            _processed.push_back(prevEntry._id);
-            _processed.push_back(entry._id);
             _workStartEntrys.erase(workStartEntry);
         }
         else
         {
             invalidEntryMsg(entry) << "work finish before work start" << std::endl;
-            _processed.push_back(entry._id);
         }
         break;
     }
     }
 }
 
-void LogProcessor::finish()
+bool LogProcessor::finish()
 {
-    auto& setProcessed = setLogEntryToProcessedC();
-    for (int entryId : _processed)
+    // everything scanned is processed except entries still waiting for their counterpart
+    auto& clearPending = clearPendingLogEntriesC();
+    clearPending.execute();
+    auto& insertPending = insertPendingLogEntryC();
+    if (_loginEntry)
+    {
+        insertPending.execute(_loginEntry->_id);
+    }
+    for (const auto& workStartEntry : _workStartEntrys)
     {
-        setProcessed.execute(entryId);
+        insertPending.execute(workStartEntry.second._id);
     }
+    auto& setProcessed = setLogEntriesToProcessedC();
+    setProcessed.execute(_employeeId, _lastEntryId);
+    clearPending.execute();
+
     auto& updateAssignment = updateEmployeeTaskStatusC();
-    for (const auto& assignment : _assignments)
+    for (int taskId : _changedAssignments)
     {
-        updateAssignment.execute(assignment.second._finished, assignment.second._timeSpent, _employeeId, assignment.first);
+        const AssignmentStatus& assignment = _assignments.at(taskId);
+        updateAssignment.execute(assignment._finished, assignment._timeSpent, _employeeId, taskId);
     }
+    return ! _changedAssignments.empty();
 }
 
 bool LogProcessor::preliminaryValidate(const ServerLogEntry &entry)
@@ -246,29 +265,12 @@ const AssignmentStatus* LogProcessor::getAssignment(const ServerLogEntry& entry)
 {
     int taskId = *entry._entry._taskId;
     auto found = _assignments.find(taskId);
-    if (found != _assignments.end())
-    {
-        return &found->second;
-    }
-    else
+    if (found == _assignments.end())
     {
-        auto& query = findTaskStatusQ();
-        query.execute(_employeeId, taskId);
-        TaskStatus status;
-        if (! query.next(status))
-        {
-            invalidEntryMsg(entry) << "invalid task id " << taskId << std::endl;
-            return nullptr;
-        }
-        if (! status._assignment)
-        {
-            invalidEntryMsg(entry) << "employee was never assigned to this task" << std::endl;
-            return nullptr;
-        }
-        auto res = _assignments.insert(std::make_pair(taskId, *status._assignment));
-        assert(res.second);
-        return &res.first->second;
+        invalidEntryMsg(entry) << "invalid task id " << taskId << " or employee was never assigned to this task" << std::endl;
+        return nullptr;
     }
+    return &found->second;
 }
 
 std::ostream& LogProcessor::invalidEntryMsg(const ServerLogEntry &entry)
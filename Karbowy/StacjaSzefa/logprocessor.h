@@ -4,26 +4,32 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
 #include <boost/optional.hpp>
 #include "serverlogentry.h"
 
-class AssignmentStatus;
+struct AssignmentStatus;
 
 class LogProcessor
 {
 public:
     LogProcessor(const std::string& employeeId);
     void checkEmployeeId();
+    void loadAssignments();
     void process(ServerLogEntry&& entry);
-    void finish();
+    // stores results, may be called on another connection than the one entries were read from;
+    // returns true if any assignment was changed
+    bool finish();
 private:
     const std::string& _employeeId;
     bool _employeeIsValid;
+    // greatest id of processed entries, entries stored later aren't marked as processed
+    int _lastEntryId;
     boost::optional<Timestamp> _previousTimestamp;
     boost::optional<ServerLogEntry> _loginEntry;
     std::map<int, AssignmentStatus> _assignments;
+    std::set<int> _changedAssignments;
     std::map<int, ServerLogEntry> _workStartEntrys;
-    std::vector<int> _processed;
 
     bool preliminaryValidate(const ServerLogEntry& entry);
     bool checkTaskId(const ServerLogEntry& entry);
@@ -1,6 +1,7 @@
 #include "mainwindow.h"
 #include "predefinedqueries.h"
 #include "server.h"
+#include "databasewriter.h"
 #include <QApplication>
 #include <QMessageBox>
 #include <QSqlDatabase>
@@ -25,22 +26,35 @@ int main(int argc, char *argv[]) {
     QApplication a(argc, argv);
 
     try {
-        initializeDatabase();
+        DatabaseConfig dbConfig;
+        initializeDatabase("StacjaSzefa.db", dbConfig);
         auto& retrieveUuid = retrieveUuidQ();
         retrieveUuid.execute();
         std::string strUuid;
-        if (! retrieveUuid.next(strUuid))
+        if (retrieveUuid.next(strUuid))
+        {
+            // otherwise GUI's reads on this connection would keep seeing database as of now
+            retrieveUuid.reset();
+        }
+        else
         {
             strUuid = boost::lexical_cast<std::string>(boost::uuids::random_generator()());
-            auto& insertUuid = insertUuidC();
-            insertUuid.execute(strUuid);
+            databaseWriter().execute([&](Database&)
+            {
+                auto& insertUuid = insertUuidC();
+                insertUuid.execute(strUuid);
+            });
         }
         std::cout << "UUID = " << strUuid << std::endl;
-        Server server(std::move(strUuid), 10001);
+        ServerConfig config;
+        config._backlog = 128;
+        config._ingestion._batchSize = 1000;
+        Server server(std::move(strUuid), config);
         // server.start();
 
         QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "KarbowyDb");
         db.setDatabaseName("StacjaSzefa.db");
+        db.setConnectOptions(QString("QSQLITE_BUSY_TIMEOUT=%1").arg(dbConfig._busyTimeoutMs));
         if (! db.open()) {
             QMessageBox::critical(0, "Błąd otwarcia bazy danych",
                                   db.lastError().text() + "\n\n" +
@@ -6,6 +6,8 @@
 #include "taskstablemodel.h"
 #include "taskassignmentdialog.h"
 #include "predefinedqueries.h"
+#include "databasewriter.h"
+#include "tasklistcache.h"
 #include "server.h"
 #include <QContextMenuEvent>
 #include <QMenu>
@@ -122,36 +124,43 @@ void MainWindow::showTaskAssignmentDialog(const QModelIndex& index)
         TaskAssignmentDialog dialog(availableEmployees, assignedEmployees, this);
         if (dialog.exec())
         {
-            bool changed = false;
-            auto& changeStatus = changeEmployeeTaskAssignmentStatusC();
-            auto& add = addEmployeeToTaskC();
-            for (const auto& employee : availableEmployees)
+            std::set<std::string> changedEmployees;
+            databaseWriter().execute([&](Database&)
             {
-                if (activeAssignedEmployees.find(employee) != activeAssignedEmployees.end())
+                auto& changeStatus = changeEmployeeTaskAssignmentStatusC();
+                auto& add = addEmployeeToTaskC();
+                for (const auto& employee : availableEmployees)
                 {
-                    changeStatus.execute(false, employee, taskId);
-                    changed = true;
+                    if (activeAssignedEmployees.find(employee) != activeAssignedEmployees.end())
+                    {
+                        changeStatus.execute(false, employee, taskId);
+                        changedEmployees.insert(employee);
+                    }
                 }
-            }
-            for (const auto& employee : assignedEmployees)
-            {
-                if (activeAssignedEmployees.find(employee) != activeAssignedEmployees.end())
-                {
-                    // nothing to do
-                }
-                else if (inactiveAssignedEmployees.find(employee) != inactiveAssignedEmployees.end())
+                for (const auto& employee : assignedEmployees)
                 {
-                    changeStatus.execute(true, employee, taskId);
-                    changed = true;
+                    if (activeAssignedEmployees.find(employee) != activeAssignedEmployees.end())
+                    {
+                        // nothing to do
+                    }
+                    else if (inactiveAssignedEmployees.find(employee) != inactiveAssignedEmployees.end())
+                    {
+                        changeStatus.execute(true, employee, taskId);
+                        changedEmployees.insert(employee);
+                    }
+                    else
+                    {
+                        add.execute(employee, taskId);
+                        changedEmployees.insert(employee);
+                    }
                 }
-                else
+            });
+            if (! changedEmployees.empty())
+            {
+                for (const auto& employee : changedEmployees)
                 {
-                    add.execute(employee, taskId);
-                    changed = true;
+                    taskListCache().invalidate(employee);
                 }
-            }
-            if (changed)
-            {
                 _tasksModel->refresh();
             }
         }
@@ -2,11 +2,14 @@
 #include "employee.h"
 #include "task.h"
 #include "serverlogentry.h"
-#include "parse.h"
-#include <vector>
+#include "databasewriter.h"
+#include <memory>
 
-static Database *db = nullptr;
-static std::vector<QueryBase*> queries;
+static std::string dbFileName;
+static DatabaseConfig dbConfig;
+static std::unique_ptr<DatabaseWriter> writer;
+// every thread has its own connection with its own prepared statements
+static thread_local std::unique_ptr<Database> threadDb;
 
 static const char* createEmployeesTable =
 "CREATE TABLE IF NOT EXISTS Employees (\n"
@@ -42,10 +45,15 @@ static const char* createLogsTable =
 "  type      INTEGER NOT NULL,\n"
 "  client    REFERENCES Clients(id),\n"
 "  employee  REFERENCES Employees(login),\n"
-"  timestamp DATETIME NOT NULL,\n"
+"  timestamp INTEGER NOT NULL,\n"
 "  task      INTEGER,\n"
 "  processed BOOL NOT NULL DEFAULT 0)\n";
 
+// ids of unprocessed log entries that have to wait for their counterpart (LOGIN, TASK START)
+static const char* createPendingLogEntriesTable =
+"CREATE TEMP TABLE IF NOT EXISTS PendingLogEntries (\n"
+"  id INTEGER PRIMARY KEY)\n";
+
 static const char* createUuidTable =
 "CREATE TABLE IF NOT EXISTS Uuid (\n"
 "  uuid   VARCHAR(100) PRIMARY KEY)\n";
@@ -90,70 +98,101 @@ static const char *commands[] = {
     populateEmployeesTasksTable
 };
 
-void initializeDatabase()
-{
-    static const char *dbFileName = "StacjaSzefa.db";
+// Schema changes applied to databases created by earlier versions; database
+// stores number of applied migrations in user_version. Append only.
+static const char* migrations[] = {
+    // 1: indexes for LogProcessor and LOG UPLOAD; partial index is used only by queries with "processed = 0"
+    "CREATE INDEX IF NOT EXISTS LogsUnprocessedByEmployee ON Logs(employee, timestamp) WHERE processed = 0;\n"
+    "CREATE INDEX IF NOT EXISTS LogsByClient ON Logs(client, timestamp);\n",
+    // 2: timestamps stored as milliseconds since epoch instead of text
+    "UPDATE Logs SET timestamp = CAST(strftime('%s', timestamp) AS INTEGER) * 1000 + CAST(substr(timestamp, 21, 3) AS INTEGER)\n"
+    "WHERE typeof(timestamp) = 'text';\n",
+    // 3: change counter for RETRIEVE TASKS SINCE; every change of data sent to clients takes next
+    //    value of SyncVersion and stores it in version of changed row
+    "ALTER TABLE Tasks ADD COLUMN version INTEGER NOT NULL DEFAULT 0;\n"
+    "ALTER TABLE EmployeesTasks ADD COLUMN version INTEGER NOT NULL DEFAULT 0;\n"
+    "CREATE TABLE SyncVersion (value INTEGER NOT NULL);\n"
+    "INSERT INTO SyncVersion(value) VALUES (0);\n"
+    "CREATE TRIGGER TaskChanged AFTER UPDATE OF title, description, status ON Tasks\n"
+    "WHEN OLD.title IS NOT NEW.title OR OLD.description IS NOT NEW.description OR OLD.status IS NOT NEW.status\n"
+    "BEGIN\n"
+    "  UPDATE SyncVersion SET value = value + 1;\n"
+    "  UPDATE Tasks SET version = (SELECT value FROM SyncVersion) WHERE id = NEW.id;\n"
+    "END;\n"
+    "CREATE TRIGGER AssignmentAdded AFTER INSERT ON EmployeesTasks\n"
+    "BEGIN\n"
+    "  UPDATE SyncVersion SET value = value + 1;\n"
+    "  UPDATE EmployeesTasks SET version = (SELECT value FROM SyncVersion) WHERE employee = NEW.employee AND task = NEW.task;\n"
+    "END;\n"
+    "CREATE TRIGGER AssignmentChanged AFTER UPDATE OF assignment_active, finished, time_spent ON EmployeesTasks\n"
+    "WHEN OLD.assignment_active IS NOT NEW.assignment_active OR OLD.finished IS NOT NEW.finished OR OLD.time_spent IS NOT NEW.time_spent\n"
+    "BEGIN\n"
+    "  UPDATE SyncVersion SET value = value + 1;\n"
+    "  UPDATE EmployeesTasks SET version = (SELECT value FROM SyncVersion) WHERE employee = NEW.employee AND task = NEW.task;\n"
+    "END;\n",
+    // 4: sequence number of last entry stored by LOG UPLOAD RESUMABLE
+    "ALTER TABLE Clients ADD COLUMN last_sequence INTEGER NOT NULL DEFAULT 0;\n"
+};
 
-    db = new Database(dbFileName);
+void initializeDatabase(const std::string& fileName, const DatabaseConfig& config)
+{
+    dbFileName = fileName;
+    dbConfig = config;
+    Database& db = database();
     for (const char* txt : commands)
     {
-        Command<> cmd(*db, txt);
-        cmd.execute();
+        db.execute(txt);
     }
+    migrateDatabase(db, migrations, sizeof(migrations) / sizeof(migrations[0]));
+    writer = std::make_unique<DatabaseWriter>(database);
+    writer->start();
 }
 
 void shutdownDatabase()
 {
-    for (QueryBase* query : queries)
+    if (writer)
     {
-        delete query;
+        writer->stop();
+        writer.reset();
     }
-    queries.clear();
-    delete db;
-    db = nullptr;
+    threadDb.reset();
+}
+
+Database& database()
+{
+    if (! threadDb)
+    {
+        threadDb = std::make_unique<Database>(dbFileName, dbConfig);
+        threadDb->execute(createPendingLogEntriesTable);
+    }
+    return *threadDb;
+}
+
+DatabaseWriter& databaseWriter()
+{
+    assert(writer);
+    return *writer;
 }
 
 Query<std::string>&
 retrieveUuidQ()
 {
     static const char* txt = "SELECT uuid FROM Uuid";
-    static Query<std::string> *query = nullptr;
-
-    if (! query)
-    {
-        query = new Query<std::string>(*db, txt);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Query<std::string> >(txt);
 }
 
 Command<std::string>&
 insertUuidC()
 {
     static const char* txt = "INSERT INTO Uuid(uuid) VALUES (?)";
-    static Command<std::string> *command = nullptr;
-
-    if (! command)
-    {
-        command = new Command<std::string>(*db, txt);
-        queries.push_back(command);
-    }
-    return *command;
+    return database().statement<Command<std::string> >(txt);
 }
 
 Query<std::unique_ptr<Employee>, std::string>&
 findEmployeeByLoginQ()
 {
     static const char* txt = "SELECT login, password, name, active FROM Employees WHERE login = ?";
-    static Query<std::unique_ptr<Employee>, std::string> *query = nullptr;
-
-    if (! query)
-    {
-        query = new Query<std::unique_ptr<Employee>, std::string>(*db, txt,
-                                                                   std::make_unique<Employee, std::string&&, std::string&&, std::string&&, bool&&>);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Query<std::unique_ptr<Employee>, std::string> >(txt, std::make_unique<Employee, std::string&&, std::string&&, std::string&&, bool&&>);
 }
 
 Query<std::unique_ptr<ClientTask>, std::string>&
@@ -164,60 +203,48 @@ findTasksForLoginQ()
                              "JOIN Employees AS E ON ET.employee = E.login\n"
                              "JOIN Tasks AS t ON ET.task = T.id\n"
                              "WHERE E.login = ? AND T.status = 0 AND ET.assignment_active = 1 AND ET.finished = 0\n";
-    static Query<std::unique_ptr<ClientTask>, std::string> *query = nullptr;
+    return database().statement<Query<std::unique_ptr<ClientTask>, std::string> >(txt, std::make_unique<ClientTask, int&&, std::string&&, std::string&&, Duration&&>);
+}
 
-    if (! query)
-    {
-        query = new Query<std::unique_ptr<ClientTask>, std::string>(*db, txt,
-                                                                    std::make_unique<ClientTask, int&&, std::string&&, std::string&&, Duration&&>);
-        queries.push_back(query);
-    }
-    return *query;
+Query<int>&
+findSyncVersionQ()
+{
+    static const char* txt = "SELECT value FROM SyncVersion\n";
+    return database().statement<Query<int> >(txt);
 }
 
-static boost::optional<Timestamp> parseTimestamp(const boost::optional<std::string>& str)
+static TaskChange makeTaskChange(int id, std::string&& title, std::string&& description, const Duration& timeSpent, bool active)
 {
-    if (str)
+    return TaskChange
     {
-        Timestamp timestamp;
-        if (! parse(*str, TimestampToken(timestamp)))
-        {
-            throw std::runtime_error("Invalid timestamp");
-        }
-        return boost::optional<Timestamp>(timestamp);
-    }
-    else
-    {
-        return boost::none;
-    }
+        std::make_unique<ClientTask>(id, std::forward<std::string>(title), description, timeSpent),
+        active
+    };
+}
+
+Query<TaskChange, std::string, int, int>&
+findTaskChangesForLoginQ()
+{
+    static const char *txt = "SELECT T.id, T.title, T.description, ET.time_spent,\n"
+                             "       T.status = 0 AND ET.assignment_active = 1 AND ET.finished = 0\n"
+                             "FROM EmployeesTasks AS ET\n"
+                             "JOIN Tasks AS T ON ET.task = T.id\n"
+                             "WHERE ET.employee = ? AND (T.version > ? OR ET.version > ?)\n";
+    return database().statement<Query<TaskChange, std::string, int, int> >(txt, makeTaskChange);
 }
 
 Command<std::string>&
 insertClientUuidC()
 {
     static const char* txt = "INSERT OR IGNORE INTO Clients(uuid) VALUES(?)\n";
-    static Command<std::string>* query = nullptr;
-
-    if (! query)
-    {
-        query = new Command<std::string>(*db, txt);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Command<std::string> >(txt);
 }
 
 Query<int, std::string>&
 findClientIdByUuidQ()
 {
     static const char* txt = "SELECT id FROM Clients WHERE uuid = ?\n";
-    static Query<int, std::string>* query = nullptr;
-
-    if (! query)
-    {
-        query = new Query<int, std::string>(*db, txt);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Query<int, std::string> >(txt);
 }
 
 Command<int, int, std::string, Timestamp, boost::optional<int> >&
@@ -225,29 +252,28 @@ insertLogEntryC()
 {
     static const char *txt = "INSERT INTO Logs(type, client, employee, timestamp, task)\n"
                              "VALUES (?, ?, ?, ?, ?)\n";
-    static Command<int, int, std::string, Timestamp, boost::optional<int> >* query = nullptr;
+    return database().statement<Command<int, int, std::string, Timestamp, boost::optional<int> > >(txt);
+}
 
-    if (! query)
-    {
-        query = new Command<int, int, std::string, Timestamp, boost::optional<int> >(*db, txt);
-        queries.push_back(query);
-    }
-    return *query;
+Query<int, int>&
+findLastSequenceForClientQ()
+{
+    static const char* txt = "SELECT last_sequence FROM Clients WHERE id = ?\n";
+    return database().statement<Query<int, int> >(txt);
+}
+
+Command<int, int>&
+updateLastSequenceC()
+{
+    static const char* txt = "UPDATE Clients SET last_sequence = ? WHERE id = ?\n";
+    return database().statement<Command<int, int> >(txt);
 }
 
 Query<boost::optional<Timestamp>, int>&
 findLastLogEntryTimeForClientQ()
 {
     static const char *txt = "SELECT MAX(timestamp) FROM Logs WHERE client = ?\n";
-    static Query<boost::optional<Timestamp>, int> *query = nullptr;
-
-    if (! query)
-    {
-        query = new Query<boost::optional<Timestamp>, int>(*db, txt,
-                                                           parseTimestamp);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Query<boost::optional<Timestamp>, int> >(txt);
 }
 
 static ServerLogEntry makeServerEmployee(int id,
@@ -276,69 +302,46 @@ findUnprocessedLogEntriesForEmployeeQ()
 {
     static const char *txt = "SELECT id, type, client, employee, timestamp, task\n"
                              "FROM Logs\n"
-                             "WHERE employee = ? AND NOT processed\n"
+                             "WHERE employee = ? AND processed = 0\n"
                              "ORDER BY timestamp\n";
-    static Query<ServerLogEntry, std::string>* query = nullptr;
-
-    if (! query)
-    {
-        query = new Query<ServerLogEntry, std::string>(*db, txt, makeServerEmployee);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Query<ServerLogEntry, std::string> >(txt, makeServerEmployee);
 }
 
-static TaskStatus makeTaskStatus(int id,
-                                 const boost::optional<bool>& finished,
-                                 const boost::optional<Duration>& timeSpent)
+static TaskAssignment makeTaskAssignment(int taskId, bool finished, const Duration& timeSpent)
 {
-    TaskStatus status;
-    status._id = id;
-    if (finished && timeSpent)
-    {
-        AssignmentStatus assignment;
-        assignment._finished = *finished;
-        assignment._timeSpent =  *timeSpent;
-        status._assignment = std::move(assignment);
-    }
-    else if (! finished && ! timeSpent)
-    {
-        status._assignment = boost::none;
-    }
-    else
-    {
-        assert(false);
-    }
-    return status;
+    TaskAssignment assignment;
+    assignment._taskId = taskId;
+    assignment._status._finished = finished;
+    assignment._status._timeSpent = timeSpent;
+    return assignment;
 }
 
-Query<TaskStatus, std::string, int>& findTaskStatusQ()
+Query<TaskAssignment, std::string>& findAssignmentsForEmployeeQ()
 {
-    static const char *txt = "SELECT T.id, ET.finished, ET.time_spent\n"
-                             "FROM Tasks AS T\n"
-                             "LEFT JOIN EmployeesTasks AS ET ON T.id = ET.task\n"
-                             "WHERE ET.employee = ? AND T.id = ?\n";
-    static Query<TaskStatus, std::string, int>* query = nullptr;
+    static const char *txt = "SELECT task, finished, time_spent\n"
+                             "FROM EmployeesTasks\n"
+                             "WHERE employee = ?\n";
+    return database().statement<Query<TaskAssignment, std::string> >(txt, makeTaskAssignment);
+}
 
-    if (! query)
-    {
-        query = new Query<TaskStatus, std::string, int>(*db, txt, makeTaskStatus);
-        queries.push_back(query);
-    }
-    return *query;
+Command<>& clearPendingLogEntriesC()
+{
+    static const char *txt = "DELETE FROM PendingLogEntries\n";
+    return database().statement<Command<> >(txt);
 }
 
-Command<int>& setLogEntryToProcessedC()
+Command<int>& insertPendingLogEntryC()
 {
-    static const char *txt = "UPDATE Logs SET processed = 1 WHERE id = ?\n";
-    static Command<int>* query = nullptr;
+    static const char *txt = "INSERT INTO PendingLogEntries(id) VALUES (?)\n";
+    return database().statement<Command<int> >(txt);
+}
 
-    if (! query)
-    {
-        query = new Command<int>(*db, txt);
-        queries.push_back(query);
-    }
-    return *query;
+Command<std::string, int>& setLogEntriesToProcessedC()
+{
+    // entries stored after processing read them have greater ids and are left for next processing
+    static const char *txt = "UPDATE Logs SET processed = 1\n"
+                             "WHERE employee = ? AND processed = 0 AND id <= ? AND id NOT IN (SELECT id FROM PendingLogEntries)\n";
+    return database().statement<Command<std::string, int> >(txt);
 }
 
 Command<bool, Duration, std::string, int>& updateEmployeeTaskStatusC()
@@ -346,28 +349,14 @@ Command<bool, Duration, std::string, int>& updateEmployeeTaskStatusC()
     static const char *txt = "UPDATE EmployeesTasks\n"
                              "SET finished = ?, time_spent = ?\n"
                              "WHERE employee = ? AND  task = ?\n";
-    static Command<bool, Duration, std::string, int>* query = nullptr;
-
-    if (! query)
-    {
-        query = new Command<bool, Duration, std::string, int>(*db, txt);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Command<bool, Duration, std::string, int> >(txt);
 }
 
 Query<std::string>&
 findAllActiveEmployeesQ()
 {
     static const char *txt = "SELECT login FROM Employees WHERE active\n";
-    static Query<std::string>* query = nullptr;
-
-    if (! query)
-    {
-        query = new Query<std::string>(*db, txt);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Query<std::string> >(txt);
 }
 
 static TaskAssignedEmployee makeTaskAssignedEmployee(std::string&& employeeId, bool assignementActive)
@@ -382,40 +371,26 @@ findAllEmployeesAssignedToTaskQ()
                              "FROM Employees AS E\n"
                              "JOIN EmployeesTasks AS ET ON E.login = ET.employee\n"
                              "WHERE ET.task = ? AND E.active\n";
-    static Query<TaskAssignedEmployee, int>* query = nullptr;
+    return database().statement<Query<TaskAssignedEmployee, int> >(txt, makeTaskAssignedEmployee);
+}
 
-    if (! query)
-    {
-        query = new Query<TaskAssignedEmployee, int>(*db, txt, makeTaskAssignedEmployee);
-        queries.push_back(query);
-    }
-    return *query;
+Query<std::string, int>&
+findAllEmployeesEverAssignedToTaskQ()
+{
+    static const char *txt = "SELECT employee FROM EmployeesTasks WHERE task = ?\n";
+    return database().statement<Query<std::string, int> >(txt);
 }
 
 Command<bool, std::string, int>&
 changeEmployeeTaskAssignmentStatusC()
 {
     static const char *txt = "UPDATE EmployeesTasks SET assignment_active = ? WHERE employee = ? AND task = ?\n";
-    static Command<bool, std::string, int>* query = nullptr;
-
-    if (! query)
-    {
-        query = new Command<bool, std::string, int>(*db, txt);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Command<bool, std::string, int> >(txt);
 }
 
 Command<std::string, int>&
 addEmployeeToTaskC()
 {
     static const char *txt = "INSERT INTO EmployeesTasks(employee, task) VALUES(?, ?)\n";
-    static Command<std::string, int>* query = nullptr;
-
-    if (! query)
-    {
-        query = new Command<std::string, int>(*db, txt);
-        queries.push_back(query);
-    }
-    return *query;
+    return database().statement<Command<std::string, int> >(txt);
 }
@@ -21,14 +21,21 @@ struct AssignmentStatus
     bool _finished;
 };
 
-struct TaskStatus
+struct TaskAssignment
 {
-    int _id;
-    boost::optional<AssignmentStatus> _assignment;
+    int _taskId;
+    AssignmentStatus _status;
 };
 
-void initializeDatabase();
+class DatabaseWriter;
+
+void initializeDatabase(const std::string& fileName, const DatabaseConfig& config);
+// closes connection of calling thread
 void shutdownDatabase();
+// connection of calling thread, opened on first use
+Database& database();
+// all modifications of database should be executed by writer
+DatabaseWriter& databaseWriter();
 
 Query<std::string>& retrieveUuidQ();
 Command<std::string>& insertUuidC();
@@ -37,12 +44,26 @@ Query<std::unique_ptr<Employee>, std::string>& findEmployeeByLoginQ();
 Command<std::string>& insertClientUuidC();
 Query<int, std::string>& findClientIdByUuidQ();
 Query<std::unique_ptr<ClientTask>, std::string>& findTasksForLoginQ();
+// current value of change counter, see migration 3
+Query<int>& findSyncVersionQ();
+struct TaskChange
+{
+    std::unique_ptr<ClientTask> _task;
+    // false if task was finished, canceled or unassigned
+    bool _active;
+};
+// tasks of employee changed after given version (passed twice: for task and for assignment)
+Query<TaskChange, std::string, int, int>& findTaskChangesForLoginQ();
 
+Query<int, int>& findLastSequenceForClientQ();
+Command<int, int>& updateLastSequenceC();
 Query<boost::optional<Timestamp>, int>& findLastLogEntryTimeForClientQ();
 Command<int, int, std::string, Timestamp, boost::optional<int> >& insertLogEntryC();
 Query<ServerLogEntry, std::string>& findUnprocessedLogEntriesForEmployeeQ();
-Query<TaskStatus, std::string, int>& findTaskStatusQ();
-Command<int>& setLogEntryToProcessedC();
+Query<TaskAssignment, std::string>& findAssignmentsForEmployeeQ();
+Command<>& clearPendingLogEntriesC();
+Command<int>& insertPendingLogEntryC();
+Command<std::string, int>& setLogEntriesToProcessedC();
 Command<bool, Duration, std::string, int>& updateEmployeeTaskStatusC();
 
 
@@ -53,6 +74,8 @@ struct TaskAssignedEmployee
     bool _assignmentActive;
 };
 Query<TaskAssignedEmployee, int>& findAllEmployeesAssignedToTaskQ();
+// logins of all employees with task on their list, including inactive ones and inactive assignments
+Query<std::string, int>& findAllEmployeesEverAssignedToTaskQ();
 Command<bool, std::string, int>& changeEmployeeTaskAssignmentStatusC();
 Command<std::string, int>& addEmployeeToTaskC();
 
@@ -0,0 +1,89 @@
+#include "reactor.h"
+#include "clientsession.h"
+#include <iostream>
+
+using namespace std::placeholders;
+
+static void onListenerError(const std::string& errorMsg)
+{
+    std::cerr << "Listener exception: " << errorMsg << std::endl;
+}
+
+Reactor::Reactor(const std::string& serverUuid, const ServerConfig& config, LogProcessingQueue& logProcessingQueue) :
+    _serverUuid(serverUuid),
+    _config(config),
+    _logProcessingQueue(logProcessingQueue),
+    _ipv4Listener(config._port, config._backlog, true),
+    _ipv6Listener(config._port, config._backlog, true),
+    _asyncIpv4Listener(_ipv4Listener, std::bind(&Reactor::acceptConnection, this, _1), onListenerError),
+    _asyncIpv6Listener(_ipv6Listener, std::bind(&Reactor::acceptConnection, this, _1), onListenerError)
+{
+    _mainLoop.addObject(_queue);
+    _mainLoop.addObject(_asyncIpv4Listener);
+    _mainLoop.addObject(_asyncIpv6Listener);
+}
+
+Reactor::~Reactor()
+{
+    assert(! _thread.joinable());
+    _sessions.clear();
+    _mainLoop.removeAllObjects();
+}
+
+void Reactor::start()
+{
+    _mainLoop.start();
+    _thread = std::thread(&Reactor::run, this);
+}
+
+void Reactor::stop()
+{
+    _queue.addTask(std::bind(&Reactor::stopOnReactorThread, this));
+    _thread.join();
+}
+
+void Reactor::removeSession(ClientSession& session)
+{
+    // session may still be on the call stack, destroy it on next loop iteration
+    _queue.addTask(std::bind(&Reactor::destroySession, this, &session));
+}
+
+void Reactor::post(const std::function<void()>& task)
+{
+    _queue.addTask(task);
+}
+
+void Reactor::run()
+{
+    try
+    {
+        _mainLoop.run();
+    }
+    catch (std::exception& ex)
+    {
+        std::cerr << "Reactor exception: " << ex.what() << std::endl;
+    }
+}
+
+void Reactor::acceptConnection(Descriptor&& fd)
+{
+    auto session = std::make_unique<ClientSession>(*this, _mainLoop, std::move(fd), _serverUuid);
+    ClientSession* sessionPtr = session.get();
+    _sessions.insert(std::make_pair(sessionPtr, std::move(session)));
+    sessionPtr->start();
+}
+
+void Reactor::destroySession(ClientSession* session)
+{
+    size_t numOfRemovedSessions = _sessions.erase(session);
+    assert(numOfRemovedSessions == 1);
+}
+
+void Reactor::stopOnReactorThread()
+{
+    for (const auto& session : _sessions)
+    {
+        session.second->stop();
+    }
+    _mainLoop.exit();
+}
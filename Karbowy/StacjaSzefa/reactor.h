@@ -0,0 +1,56 @@
+#ifndef REACTOR_H
+#define REACTOR_H
+
+#include "eventdispatcher.h"
+#include "server.h"
+#include <map>
+#include <memory>
+#include <thread>
+
+class ClientSession;
+
+// Thread running MainLoop with its own SO_REUSEPORT listeners and all sessions accepted by them.
+// Many reactors may listen on the same port, kernel distributes connections among them.
+class Reactor
+{
+public:
+    Reactor(const std::string& serverUuid, const ServerConfig& config, LogProcessingQueue& logProcessingQueue);
+    ~Reactor();
+
+    void start();
+    void stop();
+
+    const ServerConfig& config() const
+    {
+        return _config;
+    }
+
+    LogProcessingQueue& logProcessingQueue()
+    {
+        return _logProcessingQueue;
+    }
+
+    void removeSession(ClientSession& session);
+    // runs task on reactor's thread, may be called from any thread
+    void post(const std::function<void()>& task);
+
+private:
+    const std::string& _serverUuid;
+    const ServerConfig& _config;
+    LogProcessingQueue& _logProcessingQueue;
+    MainLoop _mainLoop;
+    TaskQueue _queue;
+    Ipv4Listener _ipv4Listener;
+    Ipv6Listener _ipv6Listener;
+    AsyncListener _asyncIpv4Listener;
+    AsyncListener _asyncIpv6Listener;
+    std::map<ClientSession*, std::unique_ptr<ClientSession> > _sessions;
+    std::thread _thread;
+
+    void run();
+    void acceptConnection(Descriptor&& fd);
+    void destroySession(ClientSession* session);
+    void stopOnReactorThread();
+};
+
+#endif // REACTOR_H
@@ -1,18 +1,30 @@
 #include "server.h"
 #include "clientconnection.h"
+#include "reactor.h"
 #include "taskstablemodel.h"
 #include <boost/uuid/uuid_io.hpp>
 #include <boost/lexical_cast.hpp>
 #include <signal.h>
+#include <algorithm>
 #include <iostream>
 
-Server::Server(std::string&& uuid, uint16_t port) :
+ServerConfig::ServerConfig() :
+    _port(10001),
+    _mode(ServerMode_EVENT_DRIVEN),
+    _numOfReactors(std::max(1u, std::thread::hardware_concurrency())),
+    _backlog(Listener::DEFAULT_BACKLOG),
+    _numOfLogProcessors(2),
+    _binaryFraming(true) { }
+
+Server::Server(std::string&& uuid, const ServerConfig& config) :
     _uuid(std::forward<std::string>(uuid)),
-    _ipv4Listener(port),
-    _ipv6Listener(port),
+    _config(config),
+    _logProcessingQueue(config._numOfLogProcessors),
     _run(false),
     _tasksModel(nullptr) { }
 
+Server::~Server() { }
+
 void Server::setTasksTableModel(TasksTableModel& model)
 {
     _tasksModel = &model;
@@ -20,14 +32,51 @@ void Server::setTasksTableModel(TasksTableModel& model)
 
 void Server::start()
 {
+    QObject::connect(&_logProcessingQueue, &LogProcessingQueue::tasksStatusChanged,
+                     _tasksModel, &TasksTableModel::refresh,
+                     Qt::QueuedConnection);
+    _logProcessingQueue.start();
+    switch (_config._mode)
+    {
+    case ServerMode_THREAD_PER_CONNECTION:
+        startThreadPerConnection();
+        break;
+    case ServerMode_EVENT_DRIVEN:
+        startEventDriven();
+        break;
+    }
+}
+
+void Server::stop()
+{
+    switch (_config._mode)
+    {
+    case ServerMode_THREAD_PER_CONNECTION:
+        stopThreadPerConnection();
+        break;
+    case ServerMode_EVENT_DRIVEN:
+        stopEventDriven();
+        break;
+    }
+    _logProcessingQueue.stop();
+}
+
+void Server::startThreadPerConnection()
+{
+    _ipv4Listener = std::make_unique<Ipv4Listener>(_config._port, _config._backlog);
+    _ipv6Listener = std::make_unique<Ipv6Listener>(_config._port, _config._backlog);
     _run = true;
-    _ipv4Thread = std::thread(&Server::runListener, this, &_ipv4Listener, "Ipv4Listener");
-    _ipv6Thread = std::thread(&Server::runListener, this, &_ipv6Listener, "Ipv6Listener");
+    _ipv4Thread = std::thread(&Server::runListener, this, _ipv4Listener.get(), "Ipv4Listener");
+    _ipv6Thread = std::thread(&Server::runListener, this, _ipv6Listener.get(), "Ipv6Listener");
     _reaperThread = std::thread(&Server::runReaper, this);
 }
 
-void Server::stop()
+void Server::stopThreadPerConnection()
 {
+    if (! _run)
+    {
+        return;
+    }
     _run = false;
     pthread_kill(_ipv4Thread.native_handle(), SIGUSR1);
     pthread_kill(_ipv6Thread.native_handle(), SIGUSR1);
@@ -46,6 +95,29 @@ void Server::stop()
     assert(_clientsToRemove.empty());
 }
 
+void Server::startEventDriven()
+{
+    // create all listeners first, so that bind errors are reported before any thread starts
+    for (unsigned i = 0; i < _config._numOfReactors; ++i)
+    {
+        auto reactor = std::make_unique<Reactor>(_uuid, _config, _logProcessingQueue);
+        _reactors.emplace_back(std::move(reactor));
+    }
+    for (const auto& reactor : _reactors)
+    {
+        reactor->start();
+    }
+}
+
+void Server::stopEventDriven()
+{
+    for (const auto& reactor : _reactors)
+    {
+        reactor->stop();
+    }
+    _reactors.clear();
+}
+
 void Server::removeClient(const std::shared_ptr<ClientConnection>& client)
 {
     std::lock_guard<std::mutex> guard(_clientsToRemoveMutex);
@@ -63,9 +135,6 @@ void Server::runListener(Listener* listener, const char* className)
             if (_run)
             {
                 auto client = std::make_shared<ClientConnection>(*this, std::move(stream));
-                QObject::connect(client.get(), &ClientConnection::tasksStatusChanged,
-                                 _tasksModel, &TasksTableModel::refresh,
-                                 Qt::QueuedConnection);
                 client->start();
                 std::lock_guard<std::mutex> guard(_clientsMutex);
                 auto res = _clients.insert(client);
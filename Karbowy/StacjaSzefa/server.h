@@ -2,33 +2,73 @@
 #define SERVER_H
 
 #include "sockets.h"
+#include "logingestor.h"
+#include "logprocessingqueue.h"
 #include <set>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
+#include <memory>
+#include <vector>
 
 class ClientConnection;
 class TasksTableModel;
+class Reactor;
+
+enum ServerMode
+{
+    ServerMode_THREAD_PER_CONNECTION,
+    ServerMode_EVENT_DRIVEN
+};
+
+struct ServerConfig
+{
+    ServerConfig();
+
+    uint16_t _port;
+    ServerMode _mode;
+    // used only in ServerMode_EVENT_DRIVEN
+    unsigned _numOfReactors;
+    int _backlog;
+    IngestionConfig _ingestion;
+    unsigned _numOfLogProcessors;
+    // accept clients' requests for binary framing, text protocol is used otherwise
+    bool _binaryFraming;
+};
 
 class Server
 {
 public:
-    Server(std::string&& uuid, uint16_t port);
+    Server(std::string&& uuid, const ServerConfig& config);
+    ~Server();
 
     const std::string& uuid() const
     {
         return _uuid;
     }
 
+    const ServerConfig& config() const
+    {
+        return _config;
+    }
+
+    LogProcessingQueue& logProcessingQueue()
+    {
+        return _logProcessingQueue;
+    }
+
     void setTasksTableModel(TasksTableModel& model);
     void start();
     void stop();
     void removeClient(const std::shared_ptr<ClientConnection>& client);
 private:
     std::string _uuid;
-    Ipv4Listener _ipv4Listener;
-    Ipv6Listener _ipv6Listener;
+    ServerConfig _config;
+    LogProcessingQueue _logProcessingQueue;
+    std::vector<std::unique_ptr<Reactor> > _reactors;
+    std::unique_ptr<Ipv4Listener> _ipv4Listener;
+    std::unique_ptr<Ipv6Listener> _ipv6Listener;
     std::thread _ipv4Thread;
     std::thread _ipv6Thread;
     std::thread _reaperThread;
@@ -40,6 +80,10 @@ private:
     std::atomic<bool> _run;
     TasksTableModel* _tasksModel;
 
+    void startThreadPerConnection();
+    void stopThreadPerConnection();
+    void startEventDriven();
+    void stopEventDriven();
     void runListener(Listener* listener, const char* className);
     std::shared_ptr<ClientConnection> getClientToRemove();
     void runReaper();
@@ -0,0 +1,207 @@
+#include "sessionhelpers.h"
+#include "predefinedqueries.h"
+#include "employee.h"
+#include "task.h"
+#include "logentry.h"
+#include "logprocessor.h"
+#include "databasewriter.h"
+#include "tasklistcache.h"
+#include "protocol.h"
+#include <iostream>
+
+std::unique_ptr<Employee> verifyUserId(const std::string& userId)
+{
+    auto& query = findEmployeeByLoginQ();
+    query.execute(userId);
+    std::unique_ptr<Employee> employee;
+    if (! query.next(employee))
+    {
+        std::cerr << "Can't find employee id '" << userId << '\'' << std::endl;
+        return std::unique_ptr<Employee>();
+    }
+    if (query.next(employee))
+    {
+        while (query.next(employee)) { }
+        std::cerr << "Found more than one employee with id '" << userId << '\'' << std::endl;
+        return std::unique_ptr<Employee>();
+    }
+    if (! employee->_active)
+    {
+        std::cerr << "Employee '" << userId << "' is not active" << std::endl;
+        return std::unique_ptr<Employee>();
+    }
+    return employee;
+}
+
+int storeClient(const std::string& clientUuid)
+{
+    auto& insertClientUuid = insertClientUuidC();
+    insertClientUuid.execute(clientUuid);
+    auto& findClientIdByUuid = findClientIdByUuidQ();
+    findClientIdByUuid.execute(clientUuid);
+    int clientId;
+    if (! findClientIdByUuid.next(clientId))
+    {
+        throw std::runtime_error("Client id not found after insert");
+    }
+    if (findClientIdByUuid.next(clientId))
+    {
+        throw std::runtime_error("Many client ids found after insert");
+    }
+    return clientId;
+}
+
+int registerClient(const std::string& clientUuid)
+{
+    int clientId;
+    databaseWriter().execute([&](Database&) { clientId = storeClient(clientUuid); });
+    return clientId;
+}
+
+std::vector<std::unique_ptr<ClientTask> > findTasksForEmployee(const std::string& userId)
+{
+    auto& query = findTasksForLoginQ();
+    query.execute(userId);
+    std::vector<std::unique_ptr<ClientTask> > tasks;
+    std::unique_ptr<ClientTask> task;
+    while (query.next(task))
+    {
+        tasks.emplace_back(std::move(task));
+    }
+    return tasks;
+}
+
+std::string tasksResponse(const std::string& userId, bool binaryFraming)
+{
+    return taskListCache().get(userId, binaryFraming, [&]()
+    {
+        auto tasks = findTasksForEmployee(userId);
+        return binaryFraming ? formatTasksFrames(tasks) : formatTasksText(tasks);
+    });
+}
+
+TaskListDelta findTaskChangesForEmployee(const std::string& userId, int sinceVersion)
+{
+    TaskListDelta delta;
+    // version and rows have to come from the same snapshot
+    Transaction transaction(database());
+    auto& versionQ = findSyncVersionQ();
+    versionQ.execute();
+    bool res = versionQ.next(delta._version);
+    assert(res);
+    res = versionQ.next(delta._version);
+    assert(! res);
+
+    delta._complete = sinceVersion <= 0 || sinceVersion > delta._version;
+    if (delta._complete)
+    {
+        delta._changed = findTasksForEmployee(userId);
+    }
+    else
+    {
+        auto& query = findTaskChangesForLoginQ();
+        query.execute(userId, sinceVersion, sinceVersion);
+        TaskChange change;
+        while (query.next(change))
+        {
+            if (change._active)
+            {
+                delta._changed.emplace_back(std::move(change._task));
+            }
+            else
+            {
+                delta._removed.push_back(change._task->_id);
+            }
+        }
+    }
+    transaction.commit();
+    return delta;
+}
+
+boost::optional<Timestamp> findLastLogEntryTime(int clientId)
+{
+    auto& lastEntryTimeQ = findLastLogEntryTimeForClientQ();
+    lastEntryTimeQ.execute(clientId);
+    boost::optional<Timestamp> lastEntryTime;
+    bool res = lastEntryTimeQ.next(lastEntryTime);
+    assert(res);
+    res = lastEntryTimeQ.next(lastEntryTime);
+    assert(! res);
+    return lastEntryTime;
+}
+
+void storeLogEntries(int clientId, const std::vector<LogEntry>& entries)
+{
+    auto& cmd = insertLogEntryC();
+    for (const auto& entry : entries)
+    {
+        cmd.execute(entry._type, clientId, entry._userId, entry._timestamp, entry._taskId);
+    }
+}
+
+int findLastSequence(int clientId)
+{
+    auto& query = findLastSequenceForClientQ();
+    query.execute(clientId);
+    int sequence;
+    bool res = query.next(sequence);
+    assert(res);
+    res = query.next(sequence);
+    assert(! res);
+    return sequence;
+}
+
+int findLastSequence(int clientId, boost::optional<Timestamp>& lastEntryTime)
+{
+    int sequence = findLastSequence(clientId);
+    lastEntryTime = sequence == 0 ? findLastLogEntryTime(clientId) : boost::none;
+    return sequence;
+}
+
+int storeLogEntries(int clientId, const std::vector<LogEntry>& entries, const std::vector<int>& sequences)
+{
+    assert(entries.size() == sequences.size());
+    // last sequence is checked in the same transaction, so entries sent again after lost
+    // acknowledgement, even by concurrent connection of the same client, are stored once
+    int sequence = findLastSequence(clientId);
+    auto& cmd = insertLogEntryC();
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        if (sequences[i] > sequence)
+        {
+            const auto& entry = entries[i];
+            cmd.execute(entry._type, clientId, entry._userId, entry._timestamp, entry._taskId);
+            sequence = sequences[i];
+        }
+    }
+    updateLastSequenceC().execute(sequence, clientId);
+    return sequence;
+}
+
+bool processLogs(const std::string& employeeId)
+{
+    // reading and processing is done on this thread's connection, so that employees are processed
+    // in parallel, and writer only stores results; stored values can't be outdated, as assignment's
+    // status is changed only by processing of its employee, which LogProcessingQueue doesn't run twice at once
+    LogProcessor processor(employeeId);
+    {
+        Transaction transaction(database());
+        processor.checkEmployeeId();
+        processor.loadAssignments();
+        auto& query = findUnprocessedLogEntriesForEmployeeQ();
+        query.execute(employeeId);
+        ServerLogEntry entry;
+        while (query.next(entry))
+        {
+            processor.process(std::move(entry));
+        }
+        transaction.commit();
+    }
+    bool changed = false;
+    databaseWriter().execute([&](Database&) { changed = processor.finish(); });
+    if (changed)
+    {
+        taskListCache().invalidate(employeeId);
+    }
+    return changed;
+}
@@ -0,0 +1,41 @@
+#ifndef SESSIONHELPERS_H
+#define SESSIONHELPERS_H
+
+#include "timestamp.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/optional.hpp>
+
+class Employee;
+class ClientTask;
+class LogEntry;
+class TaskListDelta;
+
+// Database side of client sessions, shared by ClientConnection and ClientSession.
+// Every thread uses its own database connection, see database().
+
+std::unique_ptr<Employee> verifyUserId(const std::string& userId);
+// inserts client unless it's already known, returns its id; has to be called from job of databaseWriter()
+int storeClient(const std::string& clientUuid);
+// storeClient on writer's thread, waits for it
+int registerClient(const std::string& clientUuid);
+std::vector<std::unique_ptr<ClientTask> > findTasksForEmployee(const std::string& userId);
+// complete response to RETRIEVE TASKS, served from TaskListCache when possible
+std::string tasksResponse(const std::string& userId, bool binaryFraming);
+// all tasks when sinceVersion is 0 or comes from different database
+TaskListDelta findTaskChangesForEmployee(const std::string& userId, int sinceVersion);
+boost::optional<Timestamp> findLastLogEntryTime(int clientId);
+// inserts entries, has to be called from job of databaseWriter()
+void storeLogEntries(int clientId, const std::vector<LogEntry>& entries);
+// sequence number of last entry stored by LOG UPLOAD RESUMABLE, 0 if none
+int findLastSequence(int clientId);
+// as above; while it's 0 also time of last entry stored by LOG UPLOAD, so that entries
+// uploaded before client switched to resumable upload aren't stored again
+int findLastSequence(int clientId, boost::optional<Timestamp>& lastEntryTime);
+// like above, but skips entries already stored; returns new last sequence number of client
+int storeLogEntries(int clientId, const std::vector<LogEntry>& entries, const std::vector<int>& sequences);
+// returns true if employee's task assignments were changed
+bool processLogs(const std::string& employeeId);
+
+#endif // SESSIONHELPERS_H
@@ -0,0 +1,56 @@
+#include "tasklistcache.h"
+#include "predefinedqueries.h"
+
+TaskListCache::TaskListCache() :
+    _generation(0) { }
+
+std::string TaskListCache::get(const std::string& employeeId, bool binaryFraming, const ResponseBuilder& makeResponse)
+{
+    Key key(employeeId, binaryFraming);
+    unsigned long generation;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto found = _responses.find(key);
+        if (found != _responses.end())
+        {
+            return found->second;
+        }
+        generation = _generation;
+    }
+
+    // built without lock, concurrent misses of the same employee build it twice
+    std::string response = makeResponse();
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (generation == _generation)
+    {
+        _responses[key] = response;
+    }
+    return response;
+}
+
+void TaskListCache::invalidate(const std::string& employeeId)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_generation;
+    _responses.erase(Key(employeeId, false));
+    _responses.erase(Key(employeeId, true));
+}
+
+TaskListCache& taskListCache()
+{
+    static TaskListCache cache;
+    return cache;
+}
+
+void invalidateTaskListsWithTask(int taskId)
+{
+    // inactive employees too, their cached list would be served after reactivation
+    auto& findAssignedEmployees = findAllEmployeesEverAssignedToTaskQ();
+    findAssignedEmployees.execute(taskId);
+    std::string employeeId;
+    while (findAssignedEmployees.next(employeeId))
+    {
+        taskListCache().invalidate(employeeId);
+    }
+}
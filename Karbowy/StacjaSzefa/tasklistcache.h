@@ -0,0 +1,37 @@
+#ifndef TASKLISTCACHE_H
+#define TASKLISTCACHE_H
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// Responses to RETRIEVE TASKS ready to be written to clients, by employee and framing.
+// Every write that changes employee's task list has to invalidate it after commit.
+class TaskListCache
+{
+public:
+    typedef std::function<std::string()> ResponseBuilder;
+
+    TaskListCache();
+    TaskListCache(const TaskListCache&) = delete;
+
+    // returns cached response, on miss builds it with makeResponse and caches it
+    std::string get(const std::string& employeeId, bool binaryFraming, const ResponseBuilder& makeResponse);
+    void invalidate(const std::string& employeeId);
+private:
+    typedef std::pair<std::string, bool> Key;
+
+    std::mutex _mutex;
+    // incremented by every invalidation; response built from data read before
+    // an invalidation is not cached, it may miss the change
+    unsigned long _generation;
+    std::map<Key, std::string> _responses;
+};
+
+TaskListCache& taskListCache();
+// invalidates task lists of all employees assigned to task, call after task was changed
+void invalidateTaskListsWithTask(int taskId);
+
+#endif // TASKLISTCACHE_H
@@ -1,6 +1,7 @@
 #include "taskstablemodel.h"
 #include "commongui.h"
 #include "predefinedqueries.h"
+#include "tasklistcache.h"
 #include <QSqlQuery>
 #include <QSqlRecord>
 #include <QSqlField>
@@ -177,6 +178,7 @@ bool TasksTableModel::setData(const QModelIndex& index, const QVariant& data, in
 
     if (ok)
     {
+        invalidateTaskListsWithTask(key);
         refresh();
     }
 